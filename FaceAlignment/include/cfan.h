@@ -31,6 +31,7 @@
  
 #pragma once
 #include <cmath>
+#include <vector>
 #include "sift.h"
 #include "common.h"
 
@@ -61,6 +62,17 @@ class CCFAN{
     */
   void FacialPointLocate(const unsigned char *gray_im, int im_width, int im_height, seeta::FaceInfo face_loc, float *facial_loc);
 
+  /** Detect five facial landmarks for a batch of faces in the same image.
+    *  The features of all faces are extracted in parallel, and each network
+    *  is evaluated once over the whole batch.
+    *  @param gray_im A grayscale image
+    *  @param im_width The width of the inpute image
+    *  @param im_height The height of the inpute image
+    *  @param face_locs The face bounding boxes
+    *  @param[out] facial_loc The locations of detected facial points, pts_num_ * 2 values for each face
+    */
+  void FacialPointLocate(const unsigned char *gray_im, int im_width, int im_height, const std::vector<seeta::FaceInfo> &face_locs, float *facial_loc);
+
  private:
   /** Extract shape indexed SIFT features.
     *  @param gray_im A grayscale image
@@ -72,6 +84,29 @@ class CCFAN{
     */
   void TtSift(const unsigned char *gray_im, int im_width, int im_height, float *face_shape, int patch_size, double *sift_fea);
 
+  /** Extract the shape indexed SIFT features arranged as the input of a network.
+    *  @param gray_im A grayscale face image
+    *  @param im_width The width of the face image
+    *  @param im_height The height of the face image
+    *  @param face_shape The locations of facial points
+    *  @param[out] net_fea The features of one face, with fea_dim_ values
+    */
+  void ShapeIndexedFeature(const unsigned char *gray_im, int im_width, int im_height, float *face_shape, float *net_fea);
+
+  /** Evaluate a local stacked autoencoder network on a batch of faces.
+    *  Each layer is computed as a product of the weight matrix and the
+    *  activations of all faces.
+    *  @param lan_w The weights of the network
+    *  @param lan_b The biases of the network
+    *  @param lan_structure The number of units in each layer
+    *  @param lan_size The number of layers
+    *  @param net_fea The input features, lan_structure[0] values for each face
+    *  @param face_num The number of faces
+    *  @param[out] shape_inc The outputs of the network, i.e., the increments of the face shapes
+    */
+  void NetworkForward(float **lan_w, float **lan_b, const int *lan_structure, int lan_size,
+    const float *net_fea, int face_num, float *shape_inc);
+
   /** Extract a image patch which is centered at point(point_x, point_y) with a given patch size.
   *  @param gray_im A grayscale image
   *  @param im_width The width of the inpute image
@@ -33,6 +33,7 @@
 #define SEETA_FACE_ALIGNMENT_H_
 
 #include <cstdlib>
+#include <vector>
 #include "common.h"
 class CCFAN;
 
@@ -60,6 +61,17 @@ class FaceAlignment{
   */
   SEETA_API bool PointDetectLandmarks(ImageData gray_im, FaceInfo face_info, FacialLandmark *points);
 
+  /** Detect five facial landmarks for each of the faces in an image, e.g.,
+  *  all faces returned by the face detector. It gives the same results as
+  *  calling the single face version on each face in turn, but the faces are
+  *  processed together, which is faster for images with many faces.
+  *  @param gray_im A grayscale image
+  *  @param face_infos The face bounding boxes
+  *  @param[out] points The locations of detected facial points, five for each
+  *  face in the order of face_infos, so it should hold 5 * face_infos.size() points
+  */
+  SEETA_API bool PointDetectLandmarks(ImageData gray_im, const std::vector<FaceInfo> & face_infos, FacialLandmark *points);
+
  private:
   CCFAN *facial_detector;
 };
@@ -33,6 +33,7 @@
 #include "cfan.h"
 #include <string.h>
 #include <algorithm>
+#include <vector>
 /** A constructor.
   *  Initialize basic parameters.
   */
@@ -155,199 +156,244 @@ void CCFAN::InitModel(const char *model_path)
   */
 void CCFAN::FacialPointLocate(const unsigned char *gray_im, int im_width, int im_height, seeta::FaceInfo face_loc, float *facial_loc)
 {
-  int sift_patch_size = 32;
-  int left_x = face_loc.bbox.x;
-  int left_y = face_loc.bbox.y;
-  int bbox_w = face_loc.bbox.width;
-  int bbox_h = face_loc.bbox.height;
-  int right_x = left_x + bbox_w - 1;
-  int right_y = left_y + bbox_h - 1;
-
-  float extend_factor = 0.05;
-  float extend_revised_y = 0.05;
-
-  /*Compute the extended region of the detected face*/
-  int extend_lx = std::max(int(floor(left_x - extend_factor*bbox_w)), int(0));
-  int extend_rx = std::min(int(floor(right_x + extend_factor*bbox_w)), int(im_width - 1));
-  int extend_ly = std::max(int(floor(left_y - (extend_factor - extend_revised_y)*bbox_h)), int(0));
-  int extend_ry = std::min(int(floor(right_y + (extend_factor + extend_revised_y)*bbox_h)), int(im_height - 1));
-
-  int face_w = extend_rx - extend_lx + 1;
-  int face_h = extend_ry - extend_ly + 1;
-
-  /*Get the face image based on the extended face region*/
-  unsigned char *face_patch = new unsigned char[face_w*face_h];
-  for (int h = 0; h < face_h; h++)
+  std::vector<seeta::FaceInfo> face_locs(1, face_loc);
+  FacialPointLocate(gray_im, im_width, im_height, face_locs, facial_loc);
+}
+
+/** Detect five facial landmarks for a batch of faces in the same image.
+  *  The features of all faces are extracted in parallel, and each network
+  *  is evaluated once over the whole batch.
+  *  @param gray_im A grayscale image
+  *  @param im_width The width of the inpute image
+  *  @param im_height The height of the inpute image
+  *  @param face_locs The face bounding boxes
+  *  @param[out] facial_loc The locations of detected facial points, pts_num_ * 2 values for each face
+  */
+void CCFAN::FacialPointLocate(const unsigned char *gray_im, int im_width, int im_height, const std::vector<seeta::FaceInfo> &face_locs, float *facial_loc)
+{
+  int face_num = int(face_locs.size());
+  if (face_num == 0)
   {
-    const unsigned char *p_origin = gray_im + (h + extend_ly)*im_width + extend_lx;
-    unsigned char *p_dest = face_patch + h*face_w;
-    memcpy(p_dest, p_origin, face_w);
+    return;
   }
 
-  /*The first local stacked autoencoder network*/
-  double *fea = new double[fea_dim_];
   int lan1_resize_w = 80;
   int lan1_resize_h = 80;
-  BYTE *lan1_patch = new BYTE[lan1_resize_w*lan1_resize_h];
-  ResizeImage(face_patch, face_w, face_h, lan1_patch, lan1_resize_w, lan1_resize_h);
-
-  for (int i = 0; i < pts_num_; i++)
+  int lan2_resize_w = 140;
+  int lan2_resize_h = 140;
+  int shape_dim = pts_num_ * 2;
+
+  std::vector<int> extend_lx(face_num);
+  std::vector<int> extend_ly(face_num);
+  std::vector<int> face_w(face_num);
+  std::vector<int> face_h(face_num);
+  std::vector<BYTE> lan2_patch(face_num * lan2_resize_w * lan2_resize_h);
+  std::vector<float> net_fea(face_num * fea_dim_);
+  std::vector<float> shape_inc(face_num * shape_dim);
+
+  /*Get the face images and extract the features for the first network*/
+#pragma omp parallel for schedule(dynamic, 1) num_threads(SEETA_NUM_THREADS)
+  for (int n = 0; n < face_num; n++)
   {
-    facial_loc[i * 2] = mean_shape_[i * 2] - 1;
-    facial_loc[i * 2 + 1] = mean_shape_[i * 2 + 1] - 1;
-  }
+    int left_x = face_locs[n].bbox.x;
+    int left_y = face_locs[n].bbox.y;
+    int bbox_w = face_locs[n].bbox.width;
+    int bbox_h = face_locs[n].bbox.height;
+    int right_x = left_x + bbox_w - 1;
+    int right_y = left_y + bbox_h - 1;
+
+    float extend_factor = 0.05;
+    float extend_revised_y = 0.05;
+
+    /*Compute the extended region of the detected face*/
+    extend_lx[n] = std::max(int(floor(left_x - extend_factor*bbox_w)), int(0));
+    int extend_rx = std::min(int(floor(right_x + extend_factor*bbox_w)), int(im_width - 1));
+    extend_ly[n] = std::max(int(floor(left_y - (extend_factor - extend_revised_y)*bbox_h)), int(0));
+    int extend_ry = std::min(int(floor(right_y + (extend_factor + extend_revised_y)*bbox_h)), int(im_height - 1));
+
+    face_w[n] = extend_rx - extend_lx[n] + 1;
+    face_h[n] = extend_ry - extend_ly[n] + 1;
+
+    /*Get the face image based on the extended face region*/
+    std::vector<BYTE> face_patch(face_w[n] * face_h[n]);
+    for (int h = 0; h < face_h[n]; h++)
+    {
+      const unsigned char *p_origin = gray_im + (h + extend_ly[n])*im_width + extend_lx[n];
+      unsigned char *p_dest = face_patch.data() + h*face_w[n];
+      memcpy(p_dest, p_origin, face_w[n]);
+    }
 
-  /*Extract the shape indexed SIFT features*/
-  TtSift(lan1_patch, lan1_resize_w, lan1_resize_h, facial_loc, 32, fea);
+    std::vector<BYTE> lan1_patch(lan1_resize_w * lan1_resize_h);
+    ResizeImage(face_patch.data(), face_w[n], face_h[n], lan1_patch.data(), lan1_resize_w, lan1_resize_h);
+    ResizeImage(face_patch.data(), face_w[n], face_h[n], lan2_patch.data() + n * lan2_resize_w * lan2_resize_h,
+      lan2_resize_w, lan2_resize_h);
 
-  float *re_fea = new float[fea_dim_];
-  for (int i = 0; i < 128; i++)
-  {
-    for (int j = 0; j < pts_num_; j++)
+    float *face_shape = facial_loc + n * shape_dim;
+    for (int i = 0; i < pts_num_; i++)
     {
-      if (isnan(fea[j * 128 + i]))
-      {
-        re_fea[i*pts_num_ + j] = 0;
-      }
-      else
-      {
-        re_fea[i*pts_num_ + j] = fea[j * 128 + i];
-      }
+      face_shape[i * 2] = mean_shape_[i * 2] - 1;
+      face_shape[i * 2 + 1] = mean_shape_[i * 2 + 1] - 1;
     }
+    ShapeIndexedFeature(lan1_patch.data(), lan1_resize_w, lan1_resize_h, face_shape, net_fea.data() + n * fea_dim_);
   }
 
-  float ** lan1_a = new float *[lan1_size_];
-
-  for (int i = 0; i < lan1_size_; i++)
-  {
-    lan1_a[i] = new float[lan1_structure_[i]];
-  }
+  /*The first local stacked autoencoder network*/
+  NetworkForward(lan1_w_, lan1_b_, lan1_structure_, lan1_size_, net_fea.data(), face_num, shape_inc.data());
 
-  for (int i = 0; i < fea_dim_; i++)
-  {
-    lan1_a[0][i] = re_fea[i];
-  }
+  float x_scale = float(lan1_resize_w) / lan2_resize_w;
+  float y_scale = float(lan1_resize_h) / lan2_resize_h;
 
-  for (int i = 0; i < lan1_size_ - 1; i++)
+  /*Extract the features for the second network at the refined face shapes*/
+#pragma omp parallel for schedule(dynamic, 1) num_threads(SEETA_NUM_THREADS)
+  for (int n = 0; n < face_num; n++)
   {
-    for (int j = 0; j < lan1_structure_[i + 1]; j++)
+    float *face_shape = facial_loc + n * shape_dim;
+    for (int i = 0; i < shape_dim; i++)
     {
-      float inner_product = 0;
-      int fea_dim = lan1_structure_[i];
-      for (int k = 0; k < fea_dim; k++)
-      {
-        inner_product = inner_product + lan1_a[i][k] * lan1_w_[i][j*fea_dim + k];
-      }
-      if (i == lan1_size_ - 2)
-      {
-        lan1_a[i + 1][j] = inner_product + lan1_b_[i][j];
-      }
-      else
-      {
-        lan1_a[i + 1][j] = 1.0 / (1 + exp(-inner_product - lan1_b_[i][j]));
-      }
-
+      face_shape[i] = face_shape[i] + shape_inc[n * shape_dim + i];
     }
+    for (int i = 0; i < pts_num_; i++)
+    {
+      face_shape[i * 2] = (face_shape[i * 2]) / x_scale;
+      face_shape[i * 2 + 1] = (face_shape[i * 2 + 1]) / y_scale;
+    }
+    ShapeIndexedFeature(lan2_patch.data() + n * lan2_resize_w * lan2_resize_h, lan2_resize_w, lan2_resize_h,
+      face_shape, net_fea.data() + n * fea_dim_);
   }
-  for (int i = 0; i < pts_num_ * 2; i++)
-  {
-    facial_loc[i] = facial_loc[i] + lan1_a[lan1_size_ - 1][i];
-  }
-  for (int i = 0; i < lan1_size_; i++)
-  {
-    delete[](lan1_a[i]);
-  }
-  delete[]lan1_a;
-  delete[]lan1_patch;
 
   /*The second local stacked autoencoder network*/
-  int lan2_resize_w = 140;
-  int lan2_resize_h = 140;
-  BYTE *lan2_patch = new BYTE[lan2_resize_w*lan2_resize_h];
-  ResizeImage(face_patch, face_w, face_h, lan2_patch, lan2_resize_w, lan2_resize_h);
+  NetworkForward(lan2_w_, lan2_b_, lan2_structure_, lan2_size_, net_fea.data(), face_num, shape_inc.data());
 
-  float x_scale = float(lan1_resize_w) / lan2_resize_w;
-  float y_scale = float(lan1_resize_h) / lan2_resize_h;
-
-  for (int i = 0; i < pts_num_; i++)
+  for (int n = 0; n < face_num; n++)
   {
-    facial_loc[i * 2] = (facial_loc[i * 2]) / x_scale;
-    facial_loc[i * 2 + 1] = (facial_loc[i * 2 + 1]) / y_scale;
+    float *face_shape = facial_loc + n * shape_dim;
+    for (int i = 0; i < shape_dim; i++)
+    {
+      face_shape[i] = face_shape[i] + shape_inc[n * shape_dim + i];
+    }
+
+    x_scale = float(lan2_resize_w) / face_w[n];
+    y_scale = float(lan2_resize_h) / face_h[n];
+
+    for (int i = 0; i < pts_num_; i++)
+    {
+      face_shape[i * 2] = (face_shape[i * 2]) / x_scale + extend_lx[n];
+      face_shape[i * 2 + 1] = (face_shape[i * 2 + 1]) / y_scale + extend_ly[n];
+    }
   }
-  /*Extract the shape indexed SIFT features*/
-  TtSift(lan2_patch, lan2_resize_w, lan2_resize_h, facial_loc, 32, fea);
+}
+
+/** Extract the shape indexed SIFT features arranged as the input of a network.
+  *  @param gray_im A grayscale face image
+  *  @param im_width The width of the face image
+  *  @param im_height The height of the face image
+  *  @param face_shape The locations of facial points
+  *  @param[out] net_fea The features of one face, with fea_dim_ values
+  */
+void CCFAN::ShapeIndexedFeature(const unsigned char *gray_im, int im_width, int im_height, float *face_shape, float *net_fea)
+{
+  std::vector<double> fea(fea_dim_);
+  TtSift(gray_im, im_width, im_height, face_shape, 32, fea.data());
 
   for (int i = 0; i < 128; i++)
   {
     for (int j = 0; j < pts_num_; j++)
     {
-      if (isnan(fea[j * 128 + i]))
+      if (std::isnan(fea[j * 128 + i]))
       {
-        re_fea[i*pts_num_ + j] = 0;
+        net_fea[i*pts_num_ + j] = 0;
       }
       else
       {
-        re_fea[i*pts_num_ + j] = fea[j * 128 + i];
+        net_fea[i*pts_num_ + j] = fea[j * 128 + i];
       }
     }
   }
+}
 
-  float ** lan2_a = new float *[lan2_size_];
-
-  for (int i = 0; i < lan2_size_; i++)
-  {
-    lan2_a[i] = new float[lan2_structure_[i]];
-  }
-
-  for (int i = 0; i < fea_dim_; i++)
-  {
-    lan2_a[0][i] = re_fea[i];
-  }
+/** Evaluate a local stacked autoencoder network on a batch of faces.
+  *  Each layer is computed as a product of the weight matrix and the
+  *  activations of all faces.
+  *  @param lan_w The weights of the network
+  *  @param lan_b The biases of the network
+  *  @param lan_structure The number of units in each layer
+  *  @param lan_size The number of layers
+  *  @param net_fea The input features, lan_structure[0] values for each face
+  *  @param face_num The number of faces
+  *  @param[out] shape_inc The outputs of the network, i.e., the increments of the face shapes
+  */
+void CCFAN::NetworkForward(float **lan_w, float **lan_b, const int *lan_structure, int lan_size,
+  const float *net_fea, int face_num, float *shape_inc)
+{
+  /*The activations of all faces in a layer are stored row by row*/
+  std::vector<float> lan_a(net_fea, net_fea + face_num * lan_structure[0]);
+  std::vector<float> lan_z;
 
-  for (int i = 0; i < lan2_size_ - 1; i++)
+  for (int i = 0; i < lan_size - 1; i++)
   {
-    for (int j = 0; j < lan2_structure_[i + 1]; j++)
+    int fea_dim = lan_structure[i];
+    int out_dim = lan_structure[i + 1];
+    bool is_output = (i == lan_size - 2);
+    const float *a = lan_a.data();
+    lan_z.resize(face_num * out_dim);
+    float *z = lan_z.data();
+
+    /*Each row of the weights is loaded once and applied to four faces at a time.
+      Every inner product is still accumulated in the order of k, so a face
+      gets the same result as when it is processed alone.*/
+#pragma omp parallel for num_threads(SEETA_NUM_THREADS)
+    for (int j = 0; j < out_dim; j++)
     {
-      float inner_product = 0;
-      int fea_dim = lan2_structure_[i];
-      for (int k = 0; k < fea_dim; k++)
+      const float *w = lan_w[i] + j*fea_dim;
+      float b = lan_b[i][j];
+      int n = 0;
+      for (; n + 4 <= face_num; n += 4)
       {
-        inner_product = inner_product + lan2_a[i][k] * lan2_w_[i][j*fea_dim + k];
+        const float *a0 = a + n*fea_dim;
+        const float *a1 = a0 + fea_dim;
+        const float *a2 = a1 + fea_dim;
+        const float *a3 = a2 + fea_dim;
+        float inner_product[4] = { 0, 0, 0, 0 };
+        for (int k = 0; k < fea_dim; k++)
+        {
+          inner_product[0] = inner_product[0] + a0[k] * w[k];
+          inner_product[1] = inner_product[1] + a1[k] * w[k];
+          inner_product[2] = inner_product[2] + a2[k] * w[k];
+          inner_product[3] = inner_product[3] + a3[k] * w[k];
+        }
+        for (int m = 0; m < 4; m++)
+        {
+          if (is_output)
+          {
+            z[(n + m)*out_dim + j] = inner_product[m] + b;
+          }
+          else
+          {
+            z[(n + m)*out_dim + j] = 1.0 / (1 + exp(-inner_product[m] - b));
+          }
+        }
       }
-      if (i == lan2_size_ - 2)
+      for (; n < face_num; n++)
       {
-        lan2_a[i + 1][j] = inner_product + lan2_b_[i][j];
+        const float *a0 = a + n*fea_dim;
+        float inner_product = 0;
+        for (int k = 0; k < fea_dim; k++)
+        {
+          inner_product = inner_product + a0[k] * w[k];
+        }
+        if (is_output)
+        {
+          z[n*out_dim + j] = inner_product + b;
+        }
+        else
+        {
+          z[n*out_dim + j] = 1.0 / (1 + exp(-inner_product - b));
+        }
       }
-      else
-      {
-        lan2_a[i + 1][j] = 1.0 / (1 + exp(-inner_product - lan2_b_[i][j]));
-      }
-
     }
+    lan_a.swap(lan_z);
   }
-  for (int i = 0; i < pts_num_ * 2; i++)
-  {
-    facial_loc[i] = facial_loc[i] + lan2_a[lan2_size_ - 1][i];
-  }
-  for (int i = 0; i < lan2_size_; i++)
-  {
-    delete[](lan2_a[i]);
-  }
-  delete[]lan2_a;
-  delete[]lan2_patch;
-
-  delete[]fea;
-  delete[]re_fea;
-  delete[]face_patch;
-
-  x_scale = float(lan2_resize_w) / face_w;
-  y_scale = float(lan2_resize_h) / face_h;
-
-  for (int i = 0; i < pts_num_; i++)
-  {
-    facial_loc[i * 2] = (facial_loc[i * 2]) / x_scale + extend_lx;
-    facial_loc[i * 2 + 1] = (facial_loc[i * 2 + 1]) / y_scale + extend_ly;
-  }
+  memcpy(shape_inc, lan_a.data(), face_num * lan_structure[lan_size - 1] * sizeof(float));
 }
 
 /** Extract shape indexed SIFT features.
@@ -32,6 +32,7 @@
 #include "face_alignment.h"
 
 #include <string>
+#include <vector>
 #include <math.h>
 #include "cfan.h"
 
@@ -73,6 +74,28 @@ namespace seeta {
     return true;
   }
 
+  /** Detect five facial landmarks for each of the faces in an image.
+   *  @param gray_im A grayscale image
+   *  @param face_infos The face bounding boxes
+   *  @param[out] points The locations of detected facial points, five for each face
+   */
+  bool FaceAlignment::PointDetectLandmarks(ImageData gray_im, const std::vector<FaceInfo> & face_infos, FacialLandmark *points)
+  {
+    if (gray_im.num_channels != 1) {
+      return false;
+    }
+    int pts_num = 5;
+    int face_num = static_cast<int>(face_infos.size());
+    std::vector<float> facial_loc(face_num * pts_num * 2);
+    facial_detector->FacialPointLocate(gray_im.data, gray_im.width, gray_im.height, face_infos, facial_loc.data());
+
+    for (int i = 0; i < face_num * pts_num; i++) {
+      points[i].x = facial_loc[i * 2];
+      points[i].y = facial_loc[i * 2 + 1];
+    }
+    return true;
+  }
+
   /** A Destructor which should never be called explicitly.
    *  Release all dynamically allocated resources.
    */
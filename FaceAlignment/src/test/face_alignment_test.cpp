@@ -100,15 +100,18 @@ int main(int argc, char** argv)
     return 0;
   }
 
-  // Detect 5 facial landmarks
-  seeta::FacialLandmark points[5];
-  point_detector.PointDetectLandmarks(image_data, faces[0], points);
+  // Detect 5 facial landmarks for all faces at once
+  std::vector<seeta::FacialLandmark> points(face_num * pts_num);
+  point_detector.PointDetectLandmarks(image_data, faces, points.data());
 
   // Visualize the results
-  cvRectangle(img_color, cvPoint(faces[0].bbox.x, faces[0].bbox.y), cvPoint(faces[0].bbox.x + faces[0].bbox.width - 1, faces[0].bbox.y + faces[0].bbox.height - 1), CV_RGB(255, 0, 0));
-  for (int i = 0; i<pts_num; i++)
+  for (int32_t f = 0; f < face_num; f++)
   {
-    cvCircle(img_color, cvPoint(points[i].x, points[i].y), 2, CV_RGB(0, 255, 0), CV_FILLED);
+    cvRectangle(img_color, cvPoint(faces[f].bbox.x, faces[f].bbox.y), cvPoint(faces[f].bbox.x + faces[f].bbox.width - 1, faces[f].bbox.y + faces[f].bbox.height - 1), CV_RGB(255, 0, 0));
+    for (int i = 0; i<pts_num; i++)
+    {
+      cvCircle(img_color, cvPoint(points[f * pts_num + i].x, points[f * pts_num + i].y), 2, CV_RGB(0, 255, 0), CV_FILLED);
+    }
   }
   cvSaveImage("result.jpg", img_color);
 
@@ -0,0 +1,127 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#ifndef SEETA_ASYNC_FACE_DETECTION_H_
+#define SEETA_ASYNC_FACE_DETECTION_H_
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <vector>
+
+#include "common.h"
+
+namespace seeta {
+
+/**
+ * @class AsyncFaceDetection
+ * @brief Face detection running on internal worker threads.
+ *
+ * Images are submitted to a bounded queue and detected by a fixed number of
+ * workers, each of which owns a `seeta::FaceDetection` object. A worker takes
+ * up to `max_batch_size` queued images at a time and detects them one after
+ * another. Results are delivered through a callback or a `std::future`.
+ */
+class AsyncFaceDetection {
+ public:
+  typedef std::function<void(const std::vector<seeta::FaceInfo> & faces)>
+    Callback;
+
+  /**
+   * @brief Create the workers and load the model for each of them.
+   *
+   * Invalid values of `num_workers`, `max_queue_size` and `max_batch_size`
+   * (non-positive ones) are replaced by 1.
+   */
+  SEETA_API AsyncFaceDetection(const char* model_path, int32_t num_workers = 1,
+    int32_t max_queue_size = 8, int32_t max_batch_size = 4);
+
+  /**
+   * @brief Finish all submitted images and stop the workers.
+   */
+  SEETA_API ~AsyncFaceDetection();
+
+  /**
+   * @brief Submit an image for detection.
+   *
+   * The image data is copied, so the buffer can be reused once this function
+   * returns. `callback` is invoked on a worker thread when detection finishes.
+   * If the queue is full, the call blocks until there is room when `wait` is
+   * true, and otherwise returns false without submitting the image. Illegal
+   * images (see `seeta::FaceDetection::Detect`) are not queued, and the
+   * callback is invoked immediately with no faces. Exceptions thrown by the
+   * callback are caught and dropped on the worker thread.
+   */
+  SEETA_API bool Submit(const seeta::ImageData & img, const Callback & callback,
+    bool wait = true);
+
+  /**
+   * @brief Submit an image and get the detection results as a future.
+   *
+   * It blocks while the queue is full. An exception thrown by detection is
+   * stored in the future.
+   */
+  SEETA_API std::future<std::vector<seeta::FaceInfo> > Submit(
+    const seeta::ImageData & img);
+
+  /**
+   * @brief Block until all submitted images have been detected.
+   */
+  SEETA_API void Wait();
+
+  /**
+   * @brief Get the number of images submitted but not finished yet.
+   */
+  SEETA_API int32_t num_pending() const;
+
+  /**
+   * @brief Configure the detectors of all workers.
+   *
+   * See `seeta::FaceDetection` for the meaning of the settings. They take
+   * effect on images detected after the call. Only the latest value of each
+   * setting is kept, and invalid values are ignored.
+   */
+  SEETA_API void SetMinFaceSize(int32_t size);
+  SEETA_API void SetMaxFaceSize(int32_t size);
+  SEETA_API void SetImagePyramidScaleFactor(float factor);
+  SEETA_API void SetWindowStep(int32_t step_x, int32_t step_y);
+  SEETA_API void SetScoreThresh(float thresh);
+
+  DISABLE_COPY_AND_ASSIGN(AsyncFaceDetection);
+
+ private:
+  class Impl;
+  Impl* impl_;
+};
+
+}  // namespace seeta
+
+#endif  // SEETA_ASYNC_FACE_DETECTION_H_
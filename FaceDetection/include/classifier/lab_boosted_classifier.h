@@ -82,6 +82,23 @@ class LABBoostedClassifier : public Classifier {
 
   virtual bool Classify(float* score = nullptr, float* outputs = nullptr);
 
+  /**
+   * @brief Classify the window `roi` of the feature map.
+   *
+   * The ROI of the feature map is left alone, so several classifiers can
+   * share one feature map from different threads. `score` may be nullptr.
+   */
+  bool Classify(const seeta::Rect & roi, float* score) const;
+
+  /**
+   * @brief Same as above, on a feature map other than the one set.
+   *
+   * The test of standard deviation is skipped if `test_std_dev` is false, for
+   * windows known to pass it, e.g. by `LABFeatureMap::GetStdDevMask()`.
+   */
+  bool Classify(const seeta::fd::LABFeatureMap & feat_map,
+    const seeta::Rect & roi, float* score, bool test_std_dev = true) const;
+
   inline virtual seeta::fd::ClassifierType type() {
     return seeta::fd::ClassifierType::LAB_Boosted_Classifier;
   }
@@ -95,6 +112,22 @@ class LABBoostedClassifier : public Classifier {
 
   inline void SetUseStdDev(bool useStdDev) { use_std_dev_ = useStdDev; }
 
+  inline bool use_std_dev() const { return use_std_dev_; }
+  inline float std_dev_thresh() const { return kStdDevThresh; }
+
+  inline int32_t num_base_classifier() const {
+    return static_cast<int32_t>(base_classifiers_.size());
+  }
+  inline const seeta::fd::LABBaseClassifier & base_classifier(
+      int32_t idx) const {
+    return *(base_classifiers_[idx]);
+  }
+  inline const std::vector<seeta::fd::LABFeature> & features() const {
+    return feat_;
+  }
+  /**< Base classifiers summed up before each test of the threshold */
+  inline static int32_t feat_group_size() { return kFeatGroupSize; }
+
  private:
   static const int32_t kFeatGroupSize = 10;
   const float kStdDevThresh = 10.0f;
@@ -49,7 +49,7 @@ class MLPLayer {
       : input_dim_(0), output_dim_(0), act_func_type_(act_func_type) {}
   ~MLPLayer() {}
 
-  void Compute(const float* input, float* output);
+  void Compute(const float* input, float* output) const;
 
   inline int32_t GetInputDim() const { return input_dim_; }
   inline int32_t GetOutputDim() const { return output_dim_; }
@@ -79,11 +79,11 @@ class MLPLayer {
   }
 
  private:
-  inline float Sigmoid(float x) {
+  inline float Sigmoid(float x) const {
     return 1.0f / (1.0f + std::exp(x));
   }
 
-  inline float ReLU(float x) {
+  inline float ReLU(float x) const {
     return (x > 0.0f ? x : 0.0f);
   }
 
@@ -103,6 +103,13 @@ class MLP {
 
   void Compute(const float* input, float* output);
 
+  /**
+   * @brief Same as above, with outputs of hidden layers kept in `layer_buf`,
+   * an array of two buffers owned by the caller.
+   */
+  void Compute(const float* input, float* output,
+    std::vector<float>* layer_buf) const;
+
   inline int32_t GetInputDim() const {
     return layers_[0]->GetInputDim();
   }
@@ -115,6 +122,10 @@ class MLP {
     return static_cast<int32_t>(layers_.size());
   }
 
+  inline const seeta::fd::MLPLayer & GetLayer(int32_t idx) const {
+    return *(layers_[idx]);
+  }
+
   void AddLayer(int32_t inputDim, int32_t outputDim, const float* weights,
       const float* bias, bool is_output = false);
 
@@ -47,8 +47,26 @@ class SURFMLP : public Classifier {
   SURFMLP() : Classifier(), model_(new seeta::fd::MLP()) {}
   virtual ~SURFMLP() {}
 
+  /** @struct Workspace
+   *  @brief Buffers of one thread classifying with a shared SURFMLP.
+   */
+  typedef struct Workspace {
+    std::vector<float> input_buf;
+    std::vector<float> output_buf;
+    std::vector<float> layer_buf[2];
+  } Workspace;
+
   virtual bool Classify(float* score = nullptr, float* outputs = nullptr);
 
+  /**
+   * @brief Classify the ROI of `feat_map` with buffers in `workspace`.
+   *
+   * The classifier itself is left unchanged, so threads can share it with
+   * their own feature maps and workspaces.
+   */
+  bool Classify(seeta::fd::SURFFeatureMap* feat_map, Workspace* workspace,
+    float* score, float* outputs) const;
+
   inline virtual void SetFeatureMap(seeta::fd::FeatureMap* feat_map) {
     feat_map_ = dynamic_cast<seeta::fd::SURFFeatureMap*>(feat_map);
   }
@@ -63,10 +81,14 @@ class SURFMLP : public Classifier {
 
   inline void SetThreshold(float thresh) { thresh_ = thresh; }
 
+  inline float threshold() const { return thresh_; }
+  /**< IDs of the features in the pool of SURFFeatureMap, starting from 1 */
+  inline const std::vector<int32_t> & feat_id() const { return feat_id_; }
+  inline const seeta::fd::MLP & model() const { return *model_; }
+
  private:
   std::vector<int32_t> feat_id_;
-  std::vector<float> input_buf_;
-  std::vector<float> output_buf_;
+  Workspace workspace_;
 
   std::shared_ptr<seeta::fd::MLP> model_;
   float thresh_;
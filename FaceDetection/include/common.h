@@ -97,6 +97,17 @@ typedef struct FaceInfo {
   double score; /**< Larger score should mean higher confidence. */
 } FaceInfo;
 
+/**
+ * A scaled copy of an image, e.g. made by a hardware scaler. Rows of `image`
+ * are `stride` bytes apart, and `scale_factor` is its size relative to the
+ * original image.
+ */
+typedef struct ScaledImage {
+  seeta::ImageData image;
+  int32_t stride;
+  float scale_factor;
+} ScaledImage;
+
   typedef struct {
     double x;
     double y;
@@ -32,12 +32,15 @@
 #ifndef SEETA_FD_DETECTOR_H_
 #define SEETA_FD_DETECTOR_H_
 
+#include <chrono>
 #include <cstdint>
 #include <string>
 #include <vector>
 
 #include "common.h"
+#include "util/image_atlas.h"
 #include "util/image_pyramid.h"
+#include "util/cell_mask.h"
 
 namespace seeta {
 namespace fd {
@@ -50,9 +53,87 @@ class Detector {
   virtual bool LoadModel(const std::string & model_path) = 0;
   virtual std::vector<seeta::FaceInfo> Detect(seeta::fd::ImagePyramid* img_pyramid) = 0;
 
+  /**
+   * @brief Detect faces and write them to a buffer owned by the caller.
+   *
+   * Detectors can override it to reuse their internal buffers, so that no heap
+   * allocation is needed once the buffers have grown to fit the input.
+   */
+  virtual void Detect(seeta::fd::ImagePyramid* img_pyramid,
+      std::vector<seeta::FaceInfo>* faces) {
+    *faces = Detect(img_pyramid);
+  }
+
+  /**
+   * @brief Detect faces, giving up the remaining work once `deadline` passes.
+   *
+   * Returns true if the search was complete, in which case the result is the
+   * same as above. Otherwise `faces` holds the detections refined so far.
+   * Detectors which cannot stop early simply ignore the deadline.
+   */
+  virtual bool Detect(seeta::fd::ImagePyramid* img_pyramid,
+      std::vector<seeta::FaceInfo>* faces,
+      const std::chrono::steady_clock::time_point & deadline) {
+    Detect(img_pyramid, faces);
+    return true;
+  }
+
+  /**
+   * @brief Detect faces on scaled images made by the caller.
+   *
+   * `levels` take the place of the image pyramid of `img`, which should be
+   * ordered from the largest scale as ImagePyramid does. They are read in
+   * place, without copying or resizing.
+   */
+  virtual void Detect(const seeta::ImageData & img,
+      const std::vector<seeta::ScaledImage> & levels,
+      std::vector<seeta::FaceInfo>* faces) {
+    faces->clear();
+  }
+
+  /**
+   * @brief Detect faces on a batch of small images packed level by level.
+   *
+   * `atlas` should have the images and scales set, and its window is set to
+   * that of the detector. Windows are only evaluated inside each image, and
+   * `faces` gets the detections of each image in its own coordinates.
+   */
+  virtual void Detect(const std::vector<seeta::ImageData> & images,
+      seeta::fd::ImageAtlas* atlas,
+      std::vector<std::vector<seeta::FaceInfo> >* faces) {
+    faces->assign(images.size(), std::vector<seeta::FaceInfo>());
+  }
+
   virtual void SetWindowSize(int32_t size) {}
+
+  /**
+   * @brief Stop refinement after `num_stage` stages of classifiers following
+   * the first hierarchy, whose outputs are then merged by NMS as the final
+   * ones. Stages run then weight the scores of the first hierarchy instead of
+   * replacing them. A negative number runs all stages.
+   */
+  virtual void SetMaxRefineStage(int32_t num_stage) {}
   virtual void SetSlideWindowStep(int32_t step_x, int32_t step_y) {}
 
+  /**
+   * @brief Skip sliding windows where nothing moves.
+   *
+   * A window of the first stage is evaluated only if its area in the original
+   * image overlaps an active cell of `mask`, which should be indexed already,
+   * and feature maps are only computed over the part of each scaled image
+   * covered by such windows. Passing nullptr turns the gating off.
+   */
+  virtual void SetMotionMask(const seeta::fd::CellMask* mask) {}
+
+  /**
+   * @brief Reuse results of the previous image where it has not changed.
+   *
+   * Active cells of `mask`, which should be indexed already, mark where the
+   * image differs from the one of the previous call. Passing nullptr turns
+   * incremental detection off.
+   */
+  virtual void SetDirtyMask(const seeta::fd::CellMask* mask) {}
+
   DISABLE_COPY_AND_ASSIGN(Detector);
 };
 
@@ -39,6 +39,45 @@
 
 namespace seeta {
 
+/** @struct DetectionROI
+ *  @brief A region of the image to search for faces.
+ *
+ * Face size limits not larger than 0 fall back to those set by
+ * SetMinFaceSize() and SetMaxFaceSize(), and the minimum size is subject to
+ * the same lower bound of 20.
+ */
+typedef struct DetectionROI {
+  seeta::Rect rect;
+  int32_t min_face_size;
+  int32_t max_face_size;
+} DetectionROI;
+
+/** @enum DetectionMode
+ *  @brief How far candidate windows are refined.
+ */
+enum DetectionMode {
+  Full_Detection,     /**< All stages of the models (default) */
+  First_MLP_Stage,    /**< Stop after the first SURF-MLP stage */
+  LAB_Stage_Only      /**< Stop after the LAB stage */
+};
+
+/** @struct ScaleStat
+ *  @brief Statistics of a scale of the image pyramid over a stream.
+ */
+typedef struct ScaleStat {
+  int32_t face_size;  /**< Size of faces fitting the window at the scale */
+  double hits;        /**< Detections at the scale, decayed by each frame */
+  bool is_scanned;    /**< Whether the scale was scanned in the last frame */
+} ScaleStat;
+
+/** @struct FaceLevel
+ *  @brief The level of the image pyramid at which a face was detected.
+ */
+typedef struct FaceLevel {
+  int32_t level;             /**< Index of the level, 0 at the largest scale */
+  seeta::ScaledImage image;  /**< The level, in place in the image pyramid */
+} FaceLevel;
+
 class FaceDetection {
  public:
   SEETA_API explicit FaceDetection(const char* model_path);
@@ -53,6 +92,117 @@ class FaceDetection {
    */
   SEETA_API std::vector<seeta::FaceInfo> Detect(const seeta::ImageData & img);
 
+  /**
+   * @brief Detect faces on input image and write them to `faces`.
+   *
+   * Same as above, except that the results are written to a vector owned by
+   * the caller. All internal buffers are kept across calls, so once they have
+   * grown to fit the input (and `faces` has enough capacity), detection on
+   * images of the same size does not allocate memory from the heap.
+   */
+  SEETA_API void Detect(const seeta::ImageData & img,
+    std::vector<seeta::FaceInfo>* faces);
+
+  /**
+   * @brief Detect faces on input image, along with the level of the image
+   * pyramid where each of them fits the detection window.
+   *
+   * `levels` gets one entry for each face in `faces`. The scaled images are
+   * kept in place after detection, so later stages can crop a face from a
+   * level close to their working resolution instead of downsampling the
+   * input again: the face is at its `bbox` times the `scale_factor` of the
+   * level. They stay valid until the next detection or change of settings,
+   * and are not filled for an image without faces. Otherwise the same as
+   * above.
+   */
+  SEETA_API void Detect(const seeta::ImageData & img,
+    std::vector<seeta::FaceInfo>* faces,
+    std::vector<seeta::FaceLevel>* levels);
+
+  /**
+   * @brief Get any level of the image pyramid kept by the detection above.
+   *
+   * Levels other than those of the faces are built on the first request.
+   * Returns false if the levels are not kept or `level` is out of range.
+   */
+  SEETA_API bool GetPyramidLevel(int32_t level,
+    seeta::ScaledImage* image) const;
+
+  /**
+   * @brief Detect faces on input image within a time budget.
+   *
+   * Work is done in order of expected value: scaled images from the coarsest
+   * one (fewest windows, largest faces), then candidate windows in order of
+   * score. The clock is checked between scaled images and between windows in
+   * refinement. Once the budget runs out no new work is started, and the
+   * fully refined detections found so far are returned, which may take
+   * slightly longer than the budget. Returns false if the result is partial;
+   * otherwise the result is the same as without a budget.
+   */
+  SEETA_API bool Detect(const seeta::ImageData & img, double time_budget_ms,
+    std::vector<seeta::FaceInfo>* faces);
+
+  /**
+   * @brief Detect faces only inside the given regions of the input image.
+   *
+   * Regions are clipped to the image, and the image pyramid and feature maps
+   * are built over each region alone, so the cost is proportional to the area
+   * searched rather than to the whole image. Faces are reported in the
+   * coordinates of the input image and sorted by score. Detections from
+   * overlapped regions are merged, keeping the one with the highest score.
+   */
+  SEETA_API void Detect(const seeta::ImageData & img,
+    const std::vector<seeta::Rect> & rois,
+    std::vector<seeta::FaceInfo>* faces);
+
+  /**
+   * @brief Same as above, with face size limits given for each region.
+   */
+  SEETA_API void Detect(const seeta::ImageData & img,
+    const std::vector<seeta::DetectionROI> & rois,
+    std::vector<seeta::FaceInfo>* faces);
+
+  /**
+   * @brief Detect faces on scaled copies of the input image made elsewhere.
+   *
+   * For sources which already produce scaled frames, e.g. by a hardware
+   * scaler, these are scanned in place instead of building the image pyramid,
+   * so no resizing or copying is done on the CPU. `img` is still needed at
+   * its original size to refine the candidates. Levels with scales outside
+   * the range of face sizes set, smaller than the detection window, or with a
+   * stride less than their width are skipped. The others are scanned from the
+   * largest scale, and give the same results as the internal pyramid if they
+   * have the same scales and pixels.
+   */
+  SEETA_API void Detect(const seeta::ImageData & img,
+    const std::vector<seeta::ScaledImage> & levels,
+    std::vector<seeta::FaceInfo>* faces);
+
+  /**
+   * @brief Detect faces on a batch of small images, e.g. thumbnails.
+   *
+   * Scaled copies of all images are packed into one atlas per scale, so that
+   * feature maps are computed and windows are scanned in one pass over the
+   * atlas instead of image by image. Windows never cross two images, and
+   * `faces` gets the detections of each image in its own coordinates, the
+   * same as detecting it alone. Images which are not gray-scale get no
+   * detections. Large images are better detected one by one.
+   */
+  SEETA_API void Detect(const std::vector<seeta::ImageData> & images,
+    std::vector<std::vector<seeta::FaceInfo> >* faces);
+
+  /**
+   * @brief Load another FuSt model to run along with those loaded before.
+   *
+   * All models work on the same image pyramid and share the feature maps, so
+   * the cost of building them is paid only once for each image. Overlapped
+   * detections of different models are merged, keeping the one with the
+   * highest score. Scores of different models may not be comparable, so the
+   * score threshold should be chosen with care. Returns false if the model
+   * fails to load, in which case the models loaded before are kept.
+   */
+  SEETA_API bool AddModel(const char* model_path);
+
   /**
    * @brief Set the minimum size of faces to detect.
    *
@@ -95,6 +245,73 @@ class FaceDetection {
    */
   SEETA_API void SetScoreThresh(float thresh);
 
+  /**
+   * @brief Trade accuracy for speed by cutting off refinement.
+   *
+   * In the fast modes the remaining candidates are still merged by NMS, and
+   * boxes are only as precise as the last stage run. Scores are on another
+   * scale, so the score threshold is reset to a value calibrated for the
+   * mode (see README), which can be changed again by SetScoreThresh().
+   */
+  SEETA_API void SetDetectionMode(seeta::DetectionMode mode);
+
+  /**
+   * @brief Search only where the frame changes, for static cameras.
+   *
+   * When enabled, Detect() on whole images keeps a running average of the
+   * input frames as background. Windows of the first stage are evaluated only
+   * where the frame differs from the background or around faces found in the
+   * previous frame, and nothing is scanned if the frame does not change at
+   * all. The whole frame is still scanned every `full_scan_interval` frames
+   * and whenever the frame size changes. Frames should come in order from a
+   * fixed camera. Detect() with regions of interest is not affected.
+   */
+  SEETA_API void SetMotionGating(bool enabled, int32_t full_scan_interval = 25);
+
+  /**
+   * @brief Reuse first stage results where the frame has not changed.
+   *
+   * When enabled, Detect() on whole images keeps the previous frame and the
+   * first stage results of each scale. Only windows reading pixels which
+   * differ from the previous frame are evaluated again, so the results are
+   * the same as without it. The frame is compared exactly, unless dirty
+   * rectangles are given by SetDirtyRects(). Incremental detection takes
+   * precedence over motion gating.
+   */
+  SEETA_API void SetIncrementalDetection(bool enabled);
+
+  /**
+   * @brief Set where the next frame differs from the previous one.
+   *
+   * Used by the next Detect() with incremental detection instead of comparing
+   * the frames, e.g. when the changed areas are known from a video decoder or
+   * a renderer. Pixels outside `rects` must not have changed.
+   */
+  SEETA_API void SetDirtyRects(const std::vector<seeta::Rect> & rects);
+
+  /**
+   * @brief Scan only scales where faces have been found, for fixed cameras.
+   *
+   * When enabled, Detect() on whole images counts the detections at each
+   * scale of the image pyramid, matched by face size, with older counts
+   * decayed by each frame. A scale is scanned if it or an adjacent scale has
+   * found faces lately, and one of the other scales is sampled in turn each
+   * frame. All scales are scanned every `full_scan_interval` frames, while
+   * nothing has been found yet, and whenever the number of scales changes.
+   * Statistics are cleared when enabled, or when the minimum face size or
+   * the scale factor changes.
+   */
+  SEETA_API void SetAdaptiveScales(bool enabled,
+    int32_t full_scan_interval = 30);
+
+  /**
+   * @brief Get the statistics of adaptive scales, from the largest scale.
+   *
+   * These can also be used to choose a fixed range of face sizes for
+   * SetMinFaceSize() and SetMaxFaceSize().
+   */
+  SEETA_API void GetScaleStats(std::vector<seeta::ScaleStat>* stats) const;
+
   DISABLE_COPY_AND_ASSIGN(FaceDetection);
 
  private:
@@ -109,6 +109,7 @@ class SURFFeatureMap : public FeatureMap {
   SURFFeatureMap() : buf_valid_reset_(false) { InitFeaturePool(); }
   virtual ~SURFFeatureMap() {}
 
+  using FeatureMap::Compute;
   virtual void Compute(const uint8_t* input, int32_t width, int32_t height);
 
   inline virtual void SetROI(const seeta::Rect & roi) {
@@ -126,10 +127,22 @@ class SURFFeatureMap : public FeatureMap {
 
   void GetFeatureVector(int32_t featID, float* featVec);
 
+  inline const seeta::fd::SURFFeaturePool & feature_pool() const {
+    return feat_pool_;
+  }
+
  private:
   void InitFeaturePool();
   void Reshape(int32_t width, int32_t height);
 
+#ifdef USE_SSE
+  /**
+   * Compute the masked gradient integral image of all channels in one pass
+   * over the input, with gradients computed on 16-bit lanes row by row.
+   */
+  void ComputeIntegralImages(const uint8_t* input);
+  void ComputeGradientRow(const uint8_t* input, int32_t r);
+#else
   void ComputeGradientImages(const uint8_t* input);
   void ComputeGradX(const int32_t* input);
   void ComputeGradY(const int32_t* input);
@@ -147,6 +160,7 @@ class SURFFeatureMap : public FeatureMap {
       src++;
     }
   }
+#endif
 
   void ComputeFeatureVector(const SURFFeature & feat, int32_t* feat_vec);
   void NormalizeFeatureVectorL2(const int32_t* feat_vec, float* feat_vec_normed,
@@ -163,6 +177,8 @@ class SURFFeatureMap : public FeatureMap {
 
   std::vector<int32_t> grad_x_;
   std::vector<int32_t> grad_y_;
+  std::vector<int16_t> grad_x_row_;
+  std::vector<int16_t> grad_y_row_;
   std::vector<int32_t> int_img_;
   std::vector<int32_t> img_buf_;
   std::vector<std::vector<int32_t> > feat_vec_buf_;
@@ -32,6 +32,9 @@
 #ifndef SEETA_FD_FEATURE_MAP_H_
 #define SEETA_FD_FEATURE_MAP_H_
 
+#include <cstring>
+#include <vector>
+
 #include "common.h"
 
 namespace seeta {
@@ -51,15 +54,40 @@ class FeatureMap {
 
   virtual void Compute(const uint8_t* input, int32_t width, int32_t height) = 0;
 
+  /**
+   * @brief Compute the map of an image whose rows are `stride` bytes apart.
+   *
+   * By default rows are packed into a buffer first. Feature maps which copy
+   * the input anyway should override it to read the rows in place.
+   */
+  virtual void Compute(const uint8_t* input, int32_t width, int32_t height,
+      int32_t stride) {
+    if (stride == width) {
+      Compute(input, width, height);
+      return;
+    }
+    packed_input_.resize(width * height);
+    for (int32_t r = 0; r < height; r++) {
+      std::memcpy(packed_input_.data() + r * width, input + r * stride,
+        width * sizeof(uint8_t));
+    }
+    Compute(packed_input_.data(), width, height);
+  }
+
   inline virtual void SetROI(const seeta::Rect & roi) {
     roi_ = roi;
   }
 
+  inline const seeta::Rect & roi() const { return roi_; }
+
  protected:
   int32_t width_;
   int32_t height_;
 
   seeta::Rect roi_;
+
+ private:
+  std::vector<uint8_t> packed_input_;
 };
 
 }  // namespace fd
@@ -33,6 +33,7 @@
 #define SEETA_FD_FUST_H_
 
 #include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <map>
 #include <memory>
@@ -42,6 +43,9 @@
 #include "classifier.h"
 #include "detector.h"
 #include "feature_map.h"
+#include "classifier/surf_mlp.h"
+#include "feat/lab_feature_map.h"
+#include "feat/surf_feature_map.h"
 #include "model_reader.h"
 
 namespace seeta {
@@ -51,19 +55,166 @@ class FuStDetector : public Detector {
  public:
   FuStDetector()
       : wnd_size_(40), slide_wnd_step_x_(4), slide_wnd_step_y_(4),
-        num_hierarchy_(0) {
-    wnd_data_buf_.resize(wnd_size_ * wnd_size_);
-    wnd_data_.resize(wnd_size_ * wnd_size_);
-  }
+        num_hierarchy_(0), use_std_dev_mask_(false), std_dev_thresh_(0.0f),
+        is_first_level_lab_(false),
+        motion_mask_(nullptr), dirty_mask_(nullptr), cache_frame_id_(0),
+        max_refine_stage_(-1), profile_(nullptr) {}
 
   ~FuStDetector() {}
 
   virtual bool LoadModel(const std::string & model_path);
   virtual std::vector<seeta::FaceInfo> Detect(seeta::fd::ImagePyramid* img_pyramid);
+  virtual void Detect(seeta::fd::ImagePyramid* img_pyramid,
+    std::vector<seeta::FaceInfo>* faces);
+
+  /**
+   * Under a deadline, scaled images are scanned from the coarsest one, where
+   * windows are fewest and faces largest, until a share of the time budget is
+   * used up (see kScanTimeRatio). Refinement then takes proposals in order of
+   * score, and stops taking new ones when the deadline passes. Proposals
+   * accepted before still go through the remaining stages, so the results are
+   * always fully refined detections.
+   */
+  virtual bool Detect(seeta::fd::ImagePyramid* img_pyramid,
+    std::vector<seeta::FaceInfo>* faces,
+    const std::chrono::steady_clock::time_point & deadline);
+
+  /**
+   * Scaled images from the caller are scanned in the given order, in place,
+   * and `img` is only used for refinement.
+   */
+  virtual void Detect(const seeta::ImageData & img,
+    const std::vector<seeta::ScaledImage> & levels,
+    std::vector<seeta::FaceInfo>* faces);
+
+  virtual void Detect(const std::vector<seeta::ImageData> & images,
+    seeta::fd::ImageAtlas* atlas,
+    std::vector<std::vector<seeta::FaceInfo> >* faces);
+
+  /**< Share of the time budget for the first stage under a deadline */
+  static const float kScanTimeRatio;
+
+  /**
+   * Detection can also be run in phases, which allows several detectors to
+   * work on the same image pyramid: ClearProposals() once, ScanLevel() for
+   * each scaled image, and RefineProposals() on the original image at last.
+   *
+   * The feature map of the first hierarchy is not computed by ScanLevel()
+   * if `compute_feat_map` is false, in which case it should have already
+   * been computed on the same scaled image, e.g. by another detector sharing
+   * the feature map (see SetFeatureMap()).
+   */
+  void ClearProposals();
+  void ScanLevel(const seeta::ImageData & img_scaled, float scale_factor,
+    bool compute_feat_map = true);
+  void ScanLevel(const seeta::ScaledImage & level,
+    bool compute_feat_map = true);
+  bool RefineProposals(const seeta::ImageData & img,
+    std::vector<seeta::FaceInfo>* faces,
+    const std::chrono::steady_clock::time_point* deadline = nullptr);
+
+  /**
+   * @brief Reverse the order of proposals from the levels scanned so far.
+   *
+   * NMS breaks ties of scores by the order of proposals, so levels scanned
+   * from the coarsest one should be put back in the usual order to get the
+   * same results.
+   */
+  void ReverseLevelOrder();
+
+  /**
+   * Batches of images are detected in the same phases: ClearBatchProposals()
+   * once, ScanAtlasLevel() for each level of the atlas, whose window should
+   * be that of the detector, and RefineBatchProposals() for each image.
+   * Proposals are kept for each image separately, in the same order as
+   * scanning the image alone, so the results are the same as well.
+   */
+  void ClearBatchProposals(int32_t num_image);
+  void ScanAtlasLevel(const seeta::ImageData & atlas_img, float scale_factor,
+    const std::vector<seeta::fd::ImageAtlas::Tile> & tiles,
+    bool compute_feat_map = true);
+  void RefineBatchProposals(int32_t image_idx, const seeta::ImageData & img,
+    std::vector<seeta::FaceInfo>* faces);
+
+  /**
+   * @brief Get the feature map used by classifiers of the given type.
+   *
+   * An empty pointer is returned if the model has no such classifiers.
+   */
+  std::shared_ptr<seeta::fd::FeatureMap> feature_map(
+    seeta::fd::ClassifierType type) const;
+
+  /**
+   * @brief Replace the feature map used by classifiers of the given type.
+   *
+   * It is used to share feature maps among detectors. Nothing is done if the
+   * model has no classifiers of the given type.
+   */
+  void SetFeatureMap(seeta::fd::ClassifierType type,
+    const std::shared_ptr<seeta::fd::FeatureMap> & feat_map);
+
+  inline seeta::fd::ClassifierType first_classifier_type() const {
+    return model_[0]->type();
+  }
+
+  /**
+   * The model is made of hierarchies, each of several classifiers which run
+   * on their own windows, and each classifier is a chain of stages. Stages of
+   * all classifiers are stored in order, and classifiers after the first
+   * hierarchy take windows from those of the previous one listed in
+   * wnd_src_id(). See LoadModel() for the file layout.
+   */
+  inline int32_t num_hierarchy() const { return num_hierarchy_; }
+  inline const std::vector<int32_t> & hierarchy_size() const {
+    return hierarchy_size_;
+  }
+  inline const std::vector<int32_t> & num_stage() const { return num_stage_; }
+  inline const std::vector<std::vector<int32_t> > & wnd_src_id() const {
+    return wnd_src_id_;
+  }
+  inline int32_t num_model() const {
+    return static_cast<int32_t>(model_.size());
+  }
+  inline std::shared_ptr<seeta::fd::Classifier> model(int32_t idx) const {
+    return model_[idx];
+  }
+
+  /** @struct StageStat
+   *  @brief Work measured on a stage of the model.
+   */
+  typedef struct StageStat {
+    int64_t num_input;   /**< Windows evaluated */
+    int64_t num_output;  /**< Windows accepted */
+    double time_ms;      /**< Time spent on evaluating the windows */
+  } StageStat;
+
+  /** @struct Profile
+   *  @brief Work of detections measured stage by stage.
+   *
+   * Windows of the first hierarchy are scanned by all of its classifiers
+   * together, so only the windows accepted by each are counted, and the time
+   * to build and scan the scaled images, feature maps included, is summed up
+   * in `scan_time_ms`. Stages are indexed in the same order as model().
+   */
+  typedef struct Profile {
+    int32_t num_detection;
+    double scan_time_ms;
+    std::vector<StageStat> stages;
+  } Profile;
+
+  /**
+   * @brief Accumulate the work of following detections into `profile`, or
+   * stop if it is nullptr.
+   *
+   * Stages are only timed as a whole, so the cost of profiling is negligible.
+   */
+  void SetProfile(Profile* profile);
 
   inline virtual void SetWindowSize(int32_t size) {
-    if (size >= 20)
+    if (size >= 20) {
       wnd_size_ = size;
+      CheckStdDevMask();
+    }
   }
 
   inline virtual void SetSlideWindowStep(int32_t step_x, int32_t step_y) {
@@ -73,12 +224,156 @@ class FuStDetector : public Detector {
       slide_wnd_step_y_ = step_y;
   }
 
+  inline virtual void SetMaxRefineStage(int32_t num_stage) {
+    max_refine_stage_ = num_stage;
+  }
+
+  inline virtual void SetMotionMask(const seeta::fd::CellMask* mask) {
+    motion_mask_ = mask;
+  }
+
+  /**
+   * The first stage results of each scaled image are cached while a dirty
+   * mask is set, and only windows which read pixels from active cells are
+   * evaluated again. The motion mask is not used meanwhile.
+   */
+  inline virtual void SetDirtyMask(const seeta::fd::CellMask* mask) {
+    dirty_mask_ = mask;
+  }
+
  private:
   std::shared_ptr<seeta::fd::ModelReader> CreateModelReader(seeta::fd::ClassifierType type);
   std::shared_ptr<seeta::fd::Classifier> CreateClassifier(seeta::fd::ClassifierType type);
   std::shared_ptr<seeta::fd::FeatureMap> CreateFeatureMap(seeta::fd::ClassifierType type);
 
-  void GetWindowData(const seeta::ImageData & img, const seeta::Rect & wnd);
+  /** @struct ScanTask
+   *  @brief A band of window rows of a scaled image, scanned as one task.
+   */
+  typedef struct ScanTask {
+    int32_t level;
+    int32_t row_begin;
+    int32_t row_end;
+    int64_t cost;
+  } ScanTask;
+
+  /**
+   * @brief Scan all scaled images on several threads.
+   *
+   * Scaled images are built at once in the arena of the image pyramid (see
+   * ImagePyramid::BuildLevels()). Large ones are split into bands of window
+   * rows, which overlap by the window height less one step, so that tasks
+   * have similar costs. Tasks are handed out from the most expensive one by a
+   * dynamic schedule, so a thread takes the next task as soon as it is idle.
+   * Each thread computes feature maps of its bands on its own. Proposals of
+   * the tasks are appended in order of level and band, the same order as
+   * scanning the levels one by one. The first hierarchy should be LAB only.
+   */
+  void DetectParallel(seeta::fd::ImagePyramid* img_pyramid,
+    std::vector<seeta::FaceInfo>* faces);
+  /**
+   * @brief Split the levels into tasks, reusing the tasks of the last frame
+   * if the level sizes, the window size and the steps are all unchanged.
+   */
+  void PlanScanTasks();
+
+  /**
+   * @brief Scan the windows inside a tile of the atlas, whose feature map of
+   * the first hierarchy has been computed.
+   *
+   * With a LAB first hierarchy tiles can be scanned on several threads, each
+   * appending to the proposals of its own tile.
+   */
+  void ScanAtlasTile(const seeta::fd::ImageAtlas::Tile & tile,
+    float scale_factor, int32_t num_wnd_x, seeta::fd::FeatureMap* feat_map,
+    std::vector<std::vector<seeta::FaceInfo> >* proposals);
+  void ScanBand(const ScanTask & task, seeta::fd::LABFeatureMap* feat_map,
+    std::vector<uint8_t>* std_dev_mask,
+    std::vector<std::vector<seeta::FaceInfo> >* proposals);
+
+  /** @struct WindowProposal
+   *  @brief A proposal of the first stage with the index of its window.
+   */
+  typedef struct WindowProposal {
+    seeta::FaceInfo info;
+    int32_t wnd_idx;
+  } WindowProposal;
+
+  /** @struct LevelCache
+   *  @brief First stage results of a scaled image for incremental detection.
+   */
+  typedef struct LevelCache {
+    int32_t width;
+    int32_t height;
+    float scale_factor;
+    int32_t src_width;
+    int32_t src_height;
+    int32_t wnd_size;
+    int32_t step_x;
+    int32_t step_y;
+    int32_t frame_id;
+    std::vector<std::vector<WindowProposal> > proposals;
+  } LevelCache;
+
+  /**
+   * @brief Get the cache of a scaled image, which is created if not found.
+   *
+   * `is_valid` is set to false for a new cache, or if the scaled image was
+   * not scanned in the previous detection, whose changes it would miss.
+   */
+  LevelCache* GetLevelCache(const seeta::ImageData & img_scaled,
+    float scale_factor, bool* is_valid);
+
+  /**
+   * @brief Mark the windows of a scaled image to evaluate in `wnd_mask_`.
+   *
+   * With a dirty mask, a window is evaluated if any source pixel of its
+   * scaled pixels, as read by ResizeImage(), lies in an active cell. Otherwise
+   * it is evaluated if its area in the original image overlaps an active cell
+   * of the motion mask. Returns false if no window is to be evaluated, or else
+   * the part of the scaled image covering them in `region`. Windows inside
+   * `region` keep their positions on the sliding grid, as its offset is a
+   * multiple of the steps.
+   */
+  bool ComputeWindowMask(const seeta::ImageData & img_scaled,
+    float scale_factor, seeta::Rect* region);
+
+  /** @brief Merge new proposals of a level with cached ones, and cache all */
+  void UpdateLevelCache(LevelCache* cache, bool is_valid);
+
+  /** @struct RefineWorker
+   *  @brief Buffers of one thread refining proposals.
+   */
+  typedef struct RefineWorker {
+    std::vector<uint8_t> wnd_data_buf;
+    std::vector<uint8_t> wnd_data;
+    std::shared_ptr<seeta::fd::SURFFeatureMap> feat_map;
+    seeta::fd::SURFMLP::Workspace mlp_workspace;
+    std::vector<float> mlp_predicts;
+  } RefineWorker;
+
+  /**
+   * @brief Classify a proposal by a classifier of the following hierarchies,
+   * and update its box and score if it is accepted. The score is replaced by
+   * the output of the classifier, or multiplied by it if `weight_score`.
+   *
+   * SURF-MLP classifiers only use buffers of `worker`, so proposals can be
+   * refined on several threads, each with its own worker.
+   */
+  bool RefineWindow(const seeta::ImageData & img, int32_t model_idx,
+    seeta::FaceInfo* wnd_info, RefineWorker* worker, bool weight_score);
+
+  void GetWindowData(const seeta::ImageData & img, const seeta::Rect & wnd,
+    RefineWorker* worker);
+  void CheckStdDevMask();
+  void CheckFirstLevelLAB();
+
+  /**< Number of scaled image layouts whose first stage results are cached */
+  static const size_t kMaxNumLevelCache = 64;
+
+  /**< Cost of classifying a window, relative to a pixel of the feature map */
+  static const int32_t kScanWindowCost = 16;
+  /**< Tasks per thread, so that cheap ones can balance the load at the end */
+  static const int32_t kNumScanTaskPerThread = 4;
 
   int32_t wnd_size_;
   int32_t slide_wnd_step_x_;
@@ -89,8 +384,59 @@ class FuStDetector : public Detector {
   std::vector<int32_t> num_stage_;
   std::vector<std::vector<int32_t> > wnd_src_id_;
 
-  std::vector<uint8_t> wnd_data_buf_;
-  std::vector<uint8_t> wnd_data_;
+  /**< Whether all classifiers of the first hierarchy reject windows by the */
+  /**< same standard deviation threshold, which is then tested in advance  */
+  /**< as long as the mask is exact for the window size                    */
+  bool use_std_dev_mask_;
+  float std_dev_thresh_;
+  std::vector<uint8_t> std_dev_mask_;
+
+  /**< Whether the first hierarchy is LAB only, whose windows can then be */
+  /**< scanned on several threads                                         */
+  bool is_first_level_lab_;
+  /**< Buffers of the first NMS, which runs on the views in parallel */
+  std::vector<std::vector<int32_t> > view_nms_mask_buf_;
+
+  const seeta::fd::CellMask* motion_mask_;
+  const seeta::fd::CellMask* dirty_mask_;
+  std::vector<uint8_t> active_region_data_;
+  std::vector<uint8_t> wnd_mask_;
+
+  /**< Scaled images, bands and per-thread buffers for DetectParallel() */
+  std::vector<seeta::ImageData> level_images_;
+  std::vector<float> level_scales_;
+  std::vector<ScanTask> scan_tasks_;
+  std::vector<int32_t> task_order_;
+  std::vector<int32_t> scan_task_geometry_;
+  std::vector<std::vector<std::vector<seeta::FaceInfo> > > task_proposals_;
+  std::vector<std::shared_ptr<seeta::fd::LABFeatureMap> > band_feat_maps_;
+  std::vector<std::vector<uint8_t> > band_std_dev_mask_;
+
+  std::vector<LevelCache> level_caches_;
+  int32_t cache_frame_id_;
+  std::vector<std::vector<int32_t> > new_wnd_idx_;
+  std::vector<WindowProposal> wnd_proposal_buf_;
+
+  std::vector<RefineWorker> refine_workers_;
+  int32_t max_refine_stage_;
+
+  Profile* profile_;
+  std::chrono::steady_clock::time_point scan_start_;
+
+  /**< Proposals of each image and tile for batch detection */
+  std::vector<std::vector<std::vector<seeta::FaceInfo> > > batch_proposals_;
+  std::vector<std::vector<std::vector<size_t> > > batch_level_begin_;
+  std::vector<std::vector<std::vector<seeta::FaceInfo> > > tile_proposals_;
+
+  /**< Buffers reused across calls of Detect() */
+  std::vector<std::vector<seeta::FaceInfo> > proposals_;
+  /**< Number of proposals of each model before each level scanned */
+  std::vector<std::vector<size_t> > level_proposal_begin_;
+  std::vector<std::vector<seeta::FaceInfo> > proposals_nms_;
+  std::vector<int32_t> buf_idx_;
+  std::vector<int32_t> wnd_order_;
+  std::vector<uint8_t> wnd_accepted_;
+  std::vector<int32_t> nms_mask_buf_;
 
   std::vector<std::shared_ptr<seeta::fd::Classifier> > model_;
   std::vector<std::shared_ptr<seeta::fd::FeatureMap> > feat_map_;
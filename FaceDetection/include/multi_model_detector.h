@@ -0,0 +1,109 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#ifndef SEETA_FD_MULTI_MODEL_DETECTOR_H_
+#define SEETA_FD_MULTI_MODEL_DETECTOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "detector.h"
+#include "fust.h"
+
+namespace seeta {
+namespace fd {
+
+/**
+ * @class MultiModelDetector
+ * @brief Run several FuSt models on one image pyramid.
+ *
+ * Each call of LoadModel() adds a model. Feature maps are shared among
+ * models by classifier type, so that the image pyramid and the feature maps
+ * of the first hierarchy are computed only once per scale, no matter how many
+ * models are loaded. Detections of different models are merged by NMS.
+ */
+class MultiModelDetector : public Detector {
+ public:
+  MultiModelDetector() : wnd_size_(40), slide_wnd_step_x_(4),
+      slide_wnd_step_y_(4), motion_mask_(nullptr), dirty_mask_(nullptr),
+      max_refine_stage_(-1) {}
+  ~MultiModelDetector() {}
+
+  virtual bool LoadModel(const std::string & model_path);
+  virtual std::vector<seeta::FaceInfo> Detect(seeta::fd::ImagePyramid* img_pyramid);
+  virtual void Detect(seeta::fd::ImagePyramid* img_pyramid,
+    std::vector<seeta::FaceInfo>* faces);
+  virtual bool Detect(seeta::fd::ImagePyramid* img_pyramid,
+    std::vector<seeta::FaceInfo>* faces,
+    const std::chrono::steady_clock::time_point & deadline);
+  virtual void Detect(const seeta::ImageData & img,
+    const std::vector<seeta::ScaledImage> & levels,
+    std::vector<seeta::FaceInfo>* faces);
+  virtual void Detect(const std::vector<seeta::ImageData> & images,
+    seeta::fd::ImageAtlas* atlas,
+    std::vector<std::vector<seeta::FaceInfo> >* faces);
+
+  virtual void SetWindowSize(int32_t size);
+  virtual void SetSlideWindowStep(int32_t step_x, int32_t step_y);
+  virtual void SetMaxRefineStage(int32_t num_stage);
+  virtual void SetMotionMask(const seeta::fd::CellMask* mask);
+  virtual void SetDirtyMask(const seeta::fd::CellMask* mask);
+
+  inline int32_t num_model() const {
+    return static_cast<int32_t>(detectors_.size());
+  }
+
+ private:
+  void MergeFaces(std::vector<seeta::FaceInfo>* faces);
+
+  int32_t wnd_size_;
+  int32_t slide_wnd_step_x_;
+  int32_t slide_wnd_step_y_;
+  const seeta::fd::CellMask* motion_mask_;
+  const seeta::fd::CellMask* dirty_mask_;
+  int32_t max_refine_stage_;
+
+  std::vector<std::shared_ptr<seeta::fd::FuStDetector> > detectors_;
+  /**< whether a detector computes its first feature map by itself */
+  std::vector<bool> compute_feat_map_;
+
+  std::vector<seeta::FaceInfo> faces_buf_;
+  std::vector<seeta::FaceInfo> merged_buf_;
+
+  DISABLE_COPY_AND_ASSIGN(MultiModelDetector);
+};
+
+}  // namespace fd
+}  // namespace seeta
+
+#endif  // SEETA_FD_MULTI_MODEL_DETECTOR_H_
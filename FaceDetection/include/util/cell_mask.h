@@ -0,0 +1,115 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+
+#ifndef SEETA_FD_UTIL_CELL_MASK_H_
+#define SEETA_FD_UTIL_CELL_MASK_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+
+namespace seeta {
+namespace fd {
+
+/**
+ * @class CellMask
+ * @brief Coarse binary mask over an image, on cells of `kCellSize` pixels.
+ *
+ * Cells are marked active by the owner, e.g. where the image moves or has
+ * changed since the previous frame. After BuildIndex(), whether a rectangle
+ * touches any active cell is answered in constant time from a summed area
+ * table of the cells.
+ */
+class CellMask {
+ public:
+  CellMask() : width_(0), height_(0), num_cell_x_(0), num_cell_y_(0),
+      num_active_cell_(0) {}
+  virtual ~CellMask() {}
+
+  /** @brief Resize the mask for an image, with all cells set to `active`. */
+  void Reset(int32_t width, int32_t height, bool active);
+
+  /** @brief Mark all cells overlapped with `rect` active. */
+  void SetActive(const seeta::Rect & rect);
+
+  /**
+   * @brief Mark cells where two images of the mask size differ in any pixel.
+   *
+   * The comparison is exact, so that results cached for inactive cells stay
+   * valid.
+   */
+  void SetChanged(const uint8_t* prev, const uint8_t* cur);
+
+  /** @brief Build the summed area table used by IsActive(). */
+  void BuildIndex();
+
+  /** @brief Whether `rect` overlaps any active cell. */
+  inline bool IsActive(const seeta::Rect & rect) const {
+    int32_t x1 = std::max(rect.x, 0) / kCellSize;
+    int32_t y1 = std::max(rect.y, 0) / kCellSize;
+    int32_t x2 = std::min((rect.x + rect.width - 1) / kCellSize + 1,
+      num_cell_x_);
+    int32_t y2 = std::min((rect.y + rect.height - 1) / kCellSize + 1,
+      num_cell_y_);
+    if (x2 <= x1 || y2 <= y1)
+      return false;
+
+    int32_t stride = num_cell_x_ + 1;
+    return (cell_sum_[y2 * stride + x2] - cell_sum_[y1 * stride + x2] -
+      cell_sum_[y2 * stride + x1] + cell_sum_[y1 * stride + x1]) > 0;
+  }
+
+  inline int32_t width() const { return width_; }
+  inline int32_t height() const { return height_; }
+  inline int32_t num_active_cell() const { return num_active_cell_; }
+
+  static const int32_t kCellSize = 16;
+
+ protected:
+  int32_t width_;
+  int32_t height_;
+  int32_t num_cell_x_;
+  int32_t num_cell_y_;
+  int32_t num_active_cell_;
+
+  std::vector<uint8_t> cell_active_;
+  std::vector<int32_t> cell_sum_;
+
+  DISABLE_COPY_AND_ASSIGN(CellMask);
+};
+
+}  // namespace fd
+}  // namespace seeta
+
+#endif  // SEETA_FD_UTIL_CELL_MASK_H_
@@ -0,0 +1,130 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#ifndef SEETA_FD_UTIL_IMAGE_ATLAS_H_
+#define SEETA_FD_UTIL_IMAGE_ATLAS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+
+namespace seeta {
+namespace fd {
+
+/**
+ * @class ImageAtlas
+ * @brief Image pyramids of many small images, packed level by level.
+ *
+ * Each level of the atlas holds the images scaled by the same factor, laid
+ * out side by side in one image, so that feature maps of all of them are
+ * computed in one pass. Scales follow ImagePyramid: from the maximum scale
+ * down by the scale step, with each image present as long as the scale is
+ * not below its own minimum. Images are placed at multiples of the sliding
+ * window steps, so that windows inside an image keep their positions on the
+ * sliding grid of the atlas. Gaps between images are zero.
+ */
+class ImageAtlas {
+ public:
+  /** @struct Tile
+   *  @brief An image scaled in the current level, placed at `rect`.
+   */
+  typedef struct Tile {
+    int32_t image_idx;
+    seeta::Rect rect;
+  } Tile;
+
+  ImageAtlas() : max_scale_(1.0f), scale_step_(0.8f), scale_factor_(1.0f),
+      min_scale_(1.0f), align_x_(1), align_y_(1), min_tile_size_(1) {}
+  ~ImageAtlas() {}
+
+  /**
+   * @brief Start the levels of a new batch.
+   *
+   * The images are read when building each level, so they should be kept
+   * until the last level. `min_scales` gives the minimum scale of each image.
+   */
+  void SetImages(const std::vector<seeta::ImageData> & images,
+    const std::vector<float> & min_scales);
+
+  inline void SetMaxScale(float max_scale) { max_scale_ = max_scale; }
+
+  inline void SetScaleStep(float step) {
+    if (step > 0.0f && step <= 1.0f)
+      scale_step_ = step;
+  }
+
+  /**
+   * @brief Set the steps which image offsets are multiples of, and the size
+   * of windows. Scaled images smaller than a window are left out.
+   */
+  inline void SetWindow(int32_t size, int32_t step_x, int32_t step_y) {
+    min_tile_size_ = std::max(size, 1);
+    align_x_ = std::max(step_x, 1);
+    align_y_ = std::max(step_y, 1);
+  }
+
+  /**
+   * @brief Build the next level, or return nullptr after the last one.
+   *
+   * The returned image and tiles() are valid until the next call.
+   */
+  const seeta::ImageData* GetNextLevel(float* scale_factor = nullptr);
+
+  inline const std::vector<Tile> & tiles() const { return tiles_; }
+
+ private:
+  /** @brief Lay out the tiles by shelves, taller ones first. */
+  void PackTiles();
+
+  float max_scale_;
+  float scale_step_;
+  float scale_factor_;
+  float min_scale_;
+  int32_t align_x_;
+  int32_t align_y_;
+  int32_t min_tile_size_;
+
+  std::vector<seeta::ImageData> images_;
+  std::vector<float> min_scales_;
+  std::vector<Tile> tiles_;
+  std::vector<int32_t> tile_order_;
+  std::vector<uint8_t> buf_;
+  seeta::ImageData atlas_;
+
+  DISABLE_COPY_AND_ASSIGN(ImageAtlas);
+};
+
+}  // namespace fd
+}  // namespace seeta
+
+#endif  // SEETA_FD_UTIL_IMAGE_ATLAS_H_
@@ -35,19 +35,28 @@
 #include <cstdint>
 #include <string>
 #include <cstring>
+#include <vector>
 
 #include "common.h"
 
 namespace seeta {
 namespace fd {
 
-static void ResizeImage(const seeta::ImageData & src, seeta::ImageData* dest) {
+/**
+ * @brief Resize `src` to the size of `dest`, whose rows are `dest_stride`
+ * pixels apart.
+ */
+static void ResizeImage(const seeta::ImageData & src, seeta::ImageData* dest,
+    int32_t dest_stride) {
   int32_t src_width = src.width;
   int32_t src_height = src.height;
   int32_t dest_width = dest->width;
   int32_t dest_height = dest->height;
   if (src_width == dest_width && src_height == dest_height) {
-    std::memcpy(dest->data, src.data, src_width * src_height * sizeof(uint8_t));
+    for (int32_t y = 0; y < dest_height; y++) {
+      std::memcpy(dest->data + y * dest_stride, src.data + y * src_width,
+        src_width * sizeof(uint8_t));
+    }
     return;
   }
 
@@ -78,21 +87,36 @@ static void ResizeImage(const seeta::ImageData & src, seeta::ImageData* dest) {
           lf_weight_y * ((1 - lf_weight_x) * src_data[(n_y_s + 1) * src_width + n_x_s] +
           lf_weight_x * src_data[(n_y_s + 1) * src_width + n_x_s + 1]);
 
-        dest_data[y * dest_width + x] = static_cast<uint8_t>(dest_val);
+        dest_data[y * dest_stride + x] = static_cast<uint8_t>(dest_val);
       }
     }
   }
 }
 
+static void ResizeImage(const seeta::ImageData & src, seeta::ImageData* dest) {
+  if (src.width == dest->width && src.height == dest->height) {
+    std::memcpy(dest->data, src.data, src.width * src.height * sizeof(uint8_t));
+    return;
+  }
+  ResizeImage(src, dest, dest->width);
+}
+
 class ImagePyramid {
  public:
   ImagePyramid()
       : max_scale_(1.0f), min_scale_(1.0f),
-        scale_factor_(1.0f), scale_step_(0.8f),
+        next_level_(0), scale_step_(0.8f),
         width1x_(0), height1x_(0),
         width_scaled_(0), height_scaled_(0),
         buf_img_width_(2), buf_img_height_(2),
-        buf_scaled_width_(2), buf_scaled_height_(2) {
+        buf_scaled_width_(2), buf_scaled_height_(2),
+        arena_(nullptr), arena_size_(0), is_levels_built_(false) {
+    // No scale step is 0, so the plan is built on its first use
+    scale_plan_.width = 0;
+    scale_plan_.height = 0;
+    scale_plan_.max_scale = 0.0f;
+    scale_plan_.min_scale = 0.0f;
+    scale_plan_.scale_step = 0.0f;
     buf_img_ = new uint8_t[buf_img_width_ * buf_img_height_];
     buf_img_scaled_ = new uint8_t[buf_scaled_width_ * buf_scaled_height_];
   }
@@ -110,6 +134,10 @@ class ImagePyramid {
     buf_scaled_width_ = 0;
     buf_scaled_height_ = 0;
 
+    delete[] arena_;
+    arena_ = nullptr;
+    arena_size_ = 0;
+
     img_scaled_.data = nullptr;
     img_scaled_.width = 0;
     img_scaled_.height = 0;
@@ -118,22 +146,42 @@ class ImagePyramid {
   inline void SetScaleStep(float step) {
     if (step > 0.0f && step <= 1.0f)
       scale_step_ = step;
+    is_levels_built_ = false;
   }
 
   inline void SetMinScale(float min_scale) {
     min_scale_ = min_scale;
+    is_levels_built_ = false;
   }
 
   inline void SetMaxScale(float max_scale) {
     max_scale_ = max_scale;
-    scale_factor_ = max_scale;
+    next_level_ = 0;
+    is_levels_built_ = false;
     UpdateBufScaled();
   }
 
   void SetImage1x(const uint8_t* img_data, int32_t width, int32_t height);
 
+  /**
+   * @brief Skip the levels whose entries in `mask` are zero.
+   *
+   * Skipped levels are not returned by GetNextScaleImage(), and neither
+   * resized by BuildLevels(). Levels beyond the mask are kept, so an empty
+   * mask keeps all levels. Levels already built are left in place.
+   */
+  inline void SetLevelMask(const std::vector<uint8_t> & mask) {
+    level_mask_.assign(mask.begin(), mask.end());
+  }
+
+  inline bool is_level_enabled(int32_t level) const {
+    return level >= static_cast<int32_t>(level_mask_.size()) ||
+      level_mask_[level] != 0;
+  }
+
   inline float min_scale() const { return min_scale_; }
   inline float max_scale() const { return max_scale_; }
+  inline float scale_step() const { return scale_step_; }
 
   inline seeta::ImageData image1x() {
     seeta::ImageData img(width1x_, height1x_, 1);
@@ -143,13 +191,97 @@ class ImagePyramid {
 
   const seeta::ImageData* GetNextScaleImage(float* scale_factor = nullptr);
 
+  /**
+   * @brief Random access to the scaled images.
+   *
+   * Level 0 is the image at the maximum scale, and each following level is
+   * smaller by the scale step, the same as returned by successive calls of
+   * GetNextScaleImage() without a level mask. The returned image is valid
+   * until the next call of either function. nullptr is returned for levels
+   * out of range. Levels skipped by the mask are still returned, and it is up
+   * to the caller to check is_level_enabled().
+   */
+  int32_t num_level() const;
+  const seeta::ImageData* GetScaleImage(int32_t level,
+    float* scale_factor = nullptr);
+
+  /**
+   * @brief Build all scaled images at once, to be kept until the input or
+   * the scales change.
+   *
+   * Levels are laid out one after another in a single arena, each starting on
+   * a `kArenaAlign` byte boundary. The arena only grows, so it is allocated
+   * once for a stream of a fixed resolution. Levels already built are not
+   * resized again. Levels skipped by the mask keep their place in the arena,
+   * but are left unfilled. GetNextScaleImage() and GetScaleImage() still use
+   * their own buffer.
+   */
+  void BuildLevels();
+
+  /**
+   * @brief Build a single level in the arena, whether skipped by the mask or
+   * not, leaving the others as they are.
+   */
+  void BuildLevel(int32_t level);
+
+  inline bool is_level_built(int32_t level) const {
+    return is_levels_built_ && level >= 0 &&
+      level < static_cast<int32_t>(level_built_.size()) &&
+      level_built_[level] != 0;
+  }
+
+  /**
+   * @brief Access a level built by BuildLevels().
+   *
+   * The returned image stays valid until the input or the scales change.
+   * nullptr is returned if the levels are not built or out of range, and
+   * levels skipped by the mask are returned unfilled (see is_level_built()).
+   */
+  const seeta::ImageData* GetLevel(int32_t level,
+    float* scale_factor = nullptr) const;
+
+  static const int32_t kArenaAlign = 64;
+
  private:
+  /**
+   * @brief Geometry of a level, with the source rows and columns and the
+   * interpolation weights of ResizeImage(), precomputed per column and row.
+   */
+  struct LevelPlan {
+    int32_t width;
+    int32_t height;
+    float scale;
+    std::vector<int32_t> src_x;
+    std::vector<int32_t> src_y;
+    std::vector<double> weight_x;
+    std::vector<double> weight_y;
+  };
+
+  /**
+   * @brief Levels for the current input size and scales.
+   *
+   * The plan is rebuilt only when any of them changes, so it is computed
+   * once for a stream of a fixed resolution and settings.
+   */
+  struct ScalePlan {
+    int32_t width;
+    int32_t height;
+    float max_scale;
+    float min_scale;
+    float scale_step;
+    std::vector<LevelPlan> levels;
+  };
+
   void UpdateBufScaled();
+  void LayOutLevels();
+  void UpdateScalePlan();
+  void ScaleImage(int32_t level, uint8_t* dest) const;
+  const seeta::ImageData* ScaleImage(int32_t level);
 
   float max_scale_;
   float min_scale_;
 
-  float scale_factor_;
+  int32_t next_level_;
   float scale_step_;
 
   int32_t width1x_;
@@ -167,6 +299,17 @@ class ImagePyramid {
   int32_t buf_scaled_height_;
 
   seeta::ImageData img_scaled_;
+
+  uint8_t* arena_;
+  size_t arena_size_;
+  /**< Whether the arena is laid out for the current input and scales */
+  bool is_levels_built_;
+  std::vector<uint8_t> level_built_;
+  std::vector<seeta::ImageData> levels_;
+  std::vector<float> level_scales_;
+
+  ScalePlan scale_plan_;
+  std::vector<uint8_t> level_mask_;
 };
 
 }  // namespace fd
@@ -0,0 +1,91 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+
+#ifndef SEETA_FD_UTIL_MOTION_MASK_H_
+#define SEETA_FD_UTIL_MOTION_MASK_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+#include "util/cell_mask.h"
+
+namespace seeta {
+namespace fd {
+
+/**
+ * @class MotionMask
+ * @brief Coarse mask of the moving parts of frames from a static camera.
+ *
+ * A running average of the frames is kept as background, and a cell is active
+ * if at least `kMinNumPixel` of its pixels differ from the background by more
+ * than the threshold. Cells can also be activated explicitly, e.g. around
+ * faces found in the previous frame, so that faces which stop moving are
+ * still tracked.
+ */
+class MotionMask : public seeta::fd::CellMask {
+ public:
+  MotionMask() : diff_thresh_(15) {}
+  ~MotionMask() {}
+
+  /**
+   * @brief Compare the frame with the background and update the background.
+   *
+   * Returns false if there is no background of the same size yet, in which
+   * case the background is initialized with the frame and all cells are
+   * marked active.
+   */
+  bool Update(const seeta::ImageData & img);
+
+  /** @brief Set the minimum absolute difference of a moving pixel. */
+  inline void SetDiffThresh(int32_t thresh) {
+    if (thresh >= 0 && thresh < 255)
+      diff_thresh_ = thresh;
+  }
+
+  static const int32_t kMinNumPixel = 4;
+
+ private:
+  void UpdateRow(const uint8_t* src, uint8_t* bg, int32_t* cell_count);
+
+  int32_t diff_thresh_;
+
+  std::vector<uint8_t> background_;
+  std::vector<int32_t> cell_count_;
+
+  DISABLE_COPY_AND_ASSIGN(MotionMask);
+};
+
+}  // namespace fd
+}  // namespace seeta
+
+#endif  // SEETA_FD_UTIL_MOTION_MASK_H_
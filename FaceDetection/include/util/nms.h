@@ -39,8 +39,26 @@
 namespace seeta {
 namespace fd {
 
+/**
+ * @brief Merge overlapped bounding boxes, keeping the one with highest score.
+ *
+ * `mask_buf` is an optional buffer to be reused across calls, which avoids
+ * allocating the merging flags each time.
+ */
 void NonMaximumSuppression(std::vector<seeta::FaceInfo>* bboxes,
-  std::vector<seeta::FaceInfo>* bboxes_nms, float iou_thresh = 0.8f);
+  std::vector<seeta::FaceInfo>* bboxes_nms, float iou_thresh = 0.8f,
+  std::vector<int32_t>* mask_buf = nullptr);
+
+/**
+ * @brief Remove detections overlapped with one of higher score.
+ *
+ * Unlike NonMaximumSuppression(), scores of the removed detections are not
+ * added to the kept ones, which suits detections from different sources,
+ * e.g. models or regions of interest. `faces` ends up sorted by score, and
+ * `buf` is an optional buffer to be reused across calls.
+ */
+void MergeOverlappedFaces(std::vector<seeta::FaceInfo>* faces,
+  float iou_thresh = 0.3f, std::vector<seeta::FaceInfo>* buf = nullptr);
 
 }  // namespace fd
 }  // namespace seeta
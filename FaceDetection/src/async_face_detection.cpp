@@ -0,0 +1,314 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include "async_face_detection.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "face_detection.h"
+
+namespace seeta {
+
+class AsyncFaceDetection::Impl {
+ public:
+  typedef std::promise<std::vector<seeta::FaceInfo> > Promise;
+
+  typedef struct Task {
+    std::vector<uint8_t> data;
+    int32_t width;
+    int32_t height;
+    AsyncFaceDetection::Callback callback;
+    std::shared_ptr<Promise> promise;  /**< set instead of the callback */
+  } Task;
+
+  /** @struct Settings
+   *  @brief The latest valid value of each detector setting.
+   *
+   * Values are checked as `seeta::FaceDetection` does, so those never set
+   * remain invalid and are ignored when applied to a detector.
+   */
+  typedef struct Settings {
+    Settings()
+        : min_face_size(0), max_face_size(-1), scale_factor(0.0f),
+          step_x(0), step_y(0), score_thresh(-1.0f) {}
+
+    int32_t min_face_size;
+    int32_t max_face_size;
+    float scale_factor;
+    int32_t step_x;
+    int32_t step_y;
+    float score_thresh;
+  } Settings;
+
+  Impl(size_t max_queue_size, size_t max_batch_size)
+      : max_queue_size_(max_queue_size), max_batch_size_(max_batch_size),
+        num_pending_(0), settings_version_(0), stop_(false) {}
+
+  ~Impl() {}
+
+  void Run(seeta::FaceDetection* detector);
+  bool Push(const seeta::ImageData & img,
+    const AsyncFaceDetection::Callback & callback,
+    const std::shared_ptr<Promise> & promise, bool wait);
+  void Process(seeta::FaceDetection* detector, Task* task,
+    std::vector<seeta::FaceInfo>* faces);
+  static void ApplySettings(const Settings & settings,
+    seeta::FaceDetection* detector);
+
+ public:
+  size_t max_queue_size_;
+  size_t max_batch_size_;
+  int32_t num_pending_;
+
+  Settings settings_;
+  int32_t settings_version_;  /**< incremented by each change of settings */
+  bool stop_;
+
+  std::deque<std::unique_ptr<Task> > queue_;
+  std::vector<std::unique_ptr<Task> > free_tasks_; /**< reused frame buffers */
+
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::condition_variable all_done_;
+
+  std::vector<std::unique_ptr<seeta::FaceDetection> > detectors_;
+  std::vector<std::thread> workers_;
+};
+
+void AsyncFaceDetection::Impl::Run(seeta::FaceDetection* detector) {
+  std::vector<std::unique_ptr<Task> > batch;
+  std::vector<seeta::FaceInfo> faces;
+  int32_t settings_version = 0;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    not_empty_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+    if (queue_.empty())
+      break;  // stopped and drained
+
+    if (settings_version != settings_version_) {
+      ApplySettings(settings_, detector);
+      settings_version = settings_version_;
+    }
+
+    while (!queue_.empty() && batch.size() < max_batch_size_) {
+      batch.push_back(std::move(queue_.front()));
+      queue_.pop_front();
+    }
+    not_full_.notify_all();
+    lock.unlock();
+
+    for (size_t i = 0; i < batch.size(); i++) {
+      Process(detector, batch[i].get(), &faces);
+      batch[i]->callback = nullptr;
+      batch[i]->promise.reset();
+    }
+
+    lock.lock();
+    num_pending_ -= static_cast<int32_t>(batch.size());
+    for (size_t i = 0; i < batch.size(); i++)
+      free_tasks_.push_back(std::move(batch[i]));
+    batch.clear();
+    if (num_pending_ == 0)
+      all_done_.notify_all();
+  }
+}
+
+void AsyncFaceDetection::Impl::Process(seeta::FaceDetection* detector,
+    Task* task, std::vector<seeta::FaceInfo>* faces) {
+  // An exception must not leave the worker thread, which would terminate the
+  // program and leave the image counted as pending.
+  try {
+    seeta::ImageData img(task->width, task->height, 1);
+    img.data = task->data.data();
+    detector->Detect(img, faces);
+    if (task->promise)
+      task->promise->set_value(*faces);
+    else if (task->callback)
+      task->callback(*faces);
+  } catch (...) {
+    if (task->promise)
+      task->promise->set_exception(std::current_exception());
+  }
+}
+
+void AsyncFaceDetection::Impl::ApplySettings(const Settings & settings,
+    seeta::FaceDetection* detector) {
+  detector->SetMinFaceSize(settings.min_face_size);
+  detector->SetMaxFaceSize(settings.max_face_size);
+  detector->SetImagePyramidScaleFactor(settings.scale_factor);
+  detector->SetWindowStep(settings.step_x, settings.step_y);
+  detector->SetScoreThresh(settings.score_thresh);
+}
+
+bool AsyncFaceDetection::Impl::Push(const seeta::ImageData & img,
+    const AsyncFaceDetection::Callback & callback,
+    const std::shared_ptr<Promise> & promise, bool wait) {
+  if (img.num_channels != 1 || img.width <= 0 || img.height <= 0 ||
+      img.data == nullptr) {
+    if (promise)
+      promise->set_value(std::vector<seeta::FaceInfo>());
+    else if (callback)
+      callback(std::vector<seeta::FaceInfo>());
+    return true;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (queue_.size() >= max_queue_size_) {
+    if (!wait)
+      return false;
+    not_full_.wait(lock, [this] { return queue_.size() < max_queue_size_; });
+  }
+
+  std::unique_ptr<Task> task;
+  if (free_tasks_.empty()) {
+    task.reset(new Task());
+  } else {
+    task = std::move(free_tasks_.back());
+    free_tasks_.pop_back();
+  }
+  int32_t len = img.width * img.height;
+  task->data.resize(len);
+  std::memcpy(task->data.data(), img.data, len * sizeof(uint8_t));
+  task->width = img.width;
+  task->height = img.height;
+  task->callback = callback;
+  task->promise = promise;
+
+  queue_.push_back(std::move(task));
+  num_pending_++;
+  not_empty_.notify_one();
+  return true;
+}
+
+AsyncFaceDetection::AsyncFaceDetection(const char* model_path,
+    int32_t num_workers, int32_t max_queue_size, int32_t max_batch_size)
+    : impl_(new seeta::AsyncFaceDetection::Impl(
+        static_cast<size_t>(max_queue_size > 0 ? max_queue_size : 1),
+        static_cast<size_t>(max_batch_size > 0 ? max_batch_size : 1))) {
+  if (num_workers <= 0)
+    num_workers = 1;
+  for (int32_t i = 0; i < num_workers; i++) {
+    impl_->detectors_.push_back(std::unique_ptr<seeta::FaceDetection>(
+      new seeta::FaceDetection(model_path)));
+  }
+  for (int32_t i = 0; i < num_workers; i++) {
+    impl_->workers_.push_back(std::thread(&Impl::Run, impl_,
+      impl_->detectors_[i].get()));
+  }
+}
+
+AsyncFaceDetection::~AsyncFaceDetection() {
+  if (impl_ != nullptr) {
+    {
+      std::lock_guard<std::mutex> lock(impl_->mutex_);
+      impl_->stop_ = true;
+    }
+    impl_->not_empty_.notify_all();
+    for (size_t i = 0; i < impl_->workers_.size(); i++)
+      impl_->workers_[i].join();
+    delete impl_;
+  }
+}
+
+bool AsyncFaceDetection::Submit(const seeta::ImageData & img,
+    const Callback & callback, bool wait) {
+  return impl_->Push(img, callback, nullptr, wait);
+}
+
+std::future<std::vector<seeta::FaceInfo> > AsyncFaceDetection::Submit(
+    const seeta::ImageData & img) {
+  std::shared_ptr<Impl::Promise> result(new Impl::Promise());
+  std::future<std::vector<seeta::FaceInfo> > future = result->get_future();
+  impl_->Push(img, nullptr, result, true);
+  return future;
+}
+
+void AsyncFaceDetection::Wait() {
+  std::unique_lock<std::mutex> lock(impl_->mutex_);
+  impl_->all_done_.wait(lock, [this] { return impl_->num_pending_ == 0; });
+}
+
+int32_t AsyncFaceDetection::num_pending() const {
+  std::lock_guard<std::mutex> lock(impl_->mutex_);
+  return impl_->num_pending_;
+}
+
+void AsyncFaceDetection::SetMinFaceSize(int32_t size) {
+  if (size >= 20) {
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->settings_.min_face_size = size;
+    impl_->settings_version_++;
+  }
+}
+
+void AsyncFaceDetection::SetMaxFaceSize(int32_t size) {
+  if (size >= 0) {
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->settings_.max_face_size = size;
+    impl_->settings_version_++;
+  }
+}
+
+void AsyncFaceDetection::SetImagePyramidScaleFactor(float factor) {
+  if (factor >= 0.01f && factor <= 0.99f) {
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->settings_.scale_factor = factor;
+    impl_->settings_version_++;
+  }
+}
+
+void AsyncFaceDetection::SetWindowStep(int32_t step_x, int32_t step_y) {
+  std::lock_guard<std::mutex> lock(impl_->mutex_);
+  if (step_x > 0)
+    impl_->settings_.step_x = step_x;
+  if (step_y > 0)
+    impl_->settings_.step_y = step_y;
+  impl_->settings_version_++;
+}
+
+void AsyncFaceDetection::SetScoreThresh(float thresh) {
+  if (thresh >= 0) {
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->settings_.score_thresh = thresh;
+    impl_->settings_version_++;
+  }
+}
+
+}  // namespace seeta
@@ -44,24 +44,41 @@ void LABBaseClassifier::SetWeights(const float* weights, int32_t num_bin) {
 }
 
 bool LABBoostedClassifier::Classify(float* score, float* outputs) {
+  float s = 0.0f;
+  bool isPos = Classify(feat_map_->roi(), &s);
+
+  if (score != nullptr)
+    *score = s;
+  if (outputs != nullptr)
+    *outputs = s;
+
+  return isPos;
+}
+
+bool LABBoostedClassifier::Classify(const seeta::Rect & roi,
+    float* score) const {
+  return Classify(*feat_map_, roi, score);
+}
+
+bool LABBoostedClassifier::Classify(const seeta::fd::LABFeatureMap & feat_map,
+    const seeta::Rect & roi, float* score, bool test_std_dev) const {
   bool isPos = true;
   float s = 0.0f;
 
   for (size_t i = 0; isPos && i < base_classifiers_.size();) {
     for (int32_t j = 0; j < kFeatGroupSize; j++, i++) {
-      uint8_t featVal = feat_map_->GetFeatureVal(feat_[i].x, feat_[i].y);
+      uint8_t featVal = feat_map.GetFeatureVal(roi, feat_[i].x, feat_[i].y);
       s += base_classifiers_[i]->weights(featVal);
     }
     if (s < base_classifiers_[i - 1]->threshold())
       isPos = false;
   }
-  isPos = isPos && ((!use_std_dev_) || feat_map_->GetStdDev() > kStdDevThresh);
+  isPos = isPos &&
+    ((!use_std_dev_) || (!test_std_dev) ||
+    feat_map.GetStdDev(roi) > kStdDevThresh);
 
   if (score != nullptr)
     *score = s;
-  if (outputs != nullptr)
-    *outputs = s;
-
   return isPos;
 }
 
@@ -36,7 +36,7 @@
 namespace seeta {
 namespace fd {
 
-void MLPLayer::Compute(const float* input, float* output) {
+void MLPLayer::Compute(const float* input, float* output) const {
 #pragma omp parallel num_threads(SEETA_NUM_THREADS)
   {
 #pragma omp for nowait
@@ -49,15 +49,20 @@ void MLPLayer::Compute(const float* input, float* output) {
 }
 
 void MLP::Compute(const float* input, float* output) {
-  layer_buf_[0].resize(layers_[0]->GetOutputDim());
-  layers_[0]->Compute(input, layer_buf_[0].data());
+  Compute(input, output, layer_buf_);
+}
+
+void MLP::Compute(const float* input, float* output,
+    std::vector<float>* layer_buf) const {
+  layer_buf[0].resize(layers_[0]->GetOutputDim());
+  layers_[0]->Compute(input, layer_buf[0].data());
 
   size_t i; /**< layer index */
   for (i = 1; i < layers_.size() - 1; i++) {
-    layer_buf_[i % 2].resize(layers_[i]->GetOutputDim());
-    layers_[i]->Compute(layer_buf_[(i + 1) % 2].data(), layer_buf_[i % 2].data());
+    layer_buf[i % 2].resize(layers_[i]->GetOutputDim());
+    layers_[i]->Compute(layer_buf[(i + 1) % 2].data(), layer_buf[i % 2].data());
   }
-  layers_.back()->Compute(layer_buf_[(i + 1) % 2].data(), output);
+  layers_.back()->Compute(layer_buf[(i + 1) % 2].data(), output);
 }
 
 void MLP::AddLayer(int32_t inputDim, int32_t outputDim, const float* weights,
@@ -37,22 +37,30 @@ namespace seeta {
 namespace fd {
 
 bool SURFMLP::Classify(float* score, float* outputs) {
-  float* dest = input_buf_.data();
+  return Classify(feat_map_, &workspace_, score, outputs);
+}
+
+bool SURFMLP::Classify(seeta::fd::SURFFeatureMap* feat_map,
+    Workspace* workspace, float* score, float* outputs) const {
+  std::vector<float> & input_buf = workspace->input_buf;
+  std::vector<float> & output_buf = workspace->output_buf;
+  input_buf.resize(model_->GetInputDim());
+  float* dest = input_buf.data();
   for (size_t i = 0; i < feat_id_.size(); i++) {
-    feat_map_->GetFeatureVector(feat_id_[i] - 1, dest);
-    dest += feat_map_->GetFeatureVectorDim(feat_id_[i]);
+    feat_map->GetFeatureVector(feat_id_[i] - 1, dest);
+    dest += feat_map->GetFeatureVectorDim(feat_id_[i]);
   }
-  output_buf_.resize(model_->GetOutputDim());
-  model_->Compute(input_buf_.data(), output_buf_.data());
+  output_buf.resize(model_->GetOutputDim());
+  model_->Compute(input_buf.data(), output_buf.data(), workspace->layer_buf);
 
   if (score != nullptr)
-    *score = output_buf_[0];
+    *score = output_buf[0];
   if (outputs != nullptr) {
-    std::memcpy(outputs, output_buf_.data(),
+    std::memcpy(outputs, output_buf.data(),
       model_->GetOutputDim() * sizeof(float));
   }
 
-  return (output_buf_[0] > thresh_);
+  return (output_buf[0] > thresh_);
 }
 
 void SURFMLP::AddFeatureByID(int32_t feat_id) {
@@ -61,8 +69,6 @@ void SURFMLP::AddFeatureByID(int32_t feat_id) {
 
 void SURFMLP::AddLayer(int32_t input_dim, int32_t output_dim,
     const float* weights, const float* bias, bool is_output) {
-  if (model_->GetLayerNum() == 0)
-    input_buf_.resize(input_dim);
   model_->AddLayer(input_dim, output_dim, weights, bias, is_output);
 }
 
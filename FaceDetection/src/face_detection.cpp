@@ -31,22 +31,34 @@
 
 #include "face_detection.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <memory>
 #include <vector>
 
 #include "detector.h"
-#include "fust.h"
+#include "multi_model_detector.h"
+#include "util/cell_mask.h"
+#include "util/image_atlas.h"
 #include "util/image_pyramid.h"
+#include "util/motion_mask.h"
+#include "util/nms.h"
 
 namespace seeta {
 
 class FaceDetection::Impl {
  public:
   Impl()
-      : detector_(new seeta::fd::FuStDetector()),
+      : detector_(new seeta::fd::MultiModelDetector()),
         slide_wnd_step_x_(4), slide_wnd_step_y_(4),
         min_face_size_(20), max_face_size_(-1),
-        cls_thresh_(3.85f) {}
+        cls_thresh_(3.85f), motion_gating_(false), full_scan_interval_(25),
+        num_gated_frame_(0), incremental_(false), has_dirty_rects_(false),
+        prev_frame_width_(0), prev_frame_height_(0), adaptive_scales_(false),
+        scale_scan_interval_(30), num_adaptive_frame_(0),
+        next_sampled_level_(0), has_pyramid_levels_(false) {}
 
   ~Impl() {}
 
@@ -55,8 +67,39 @@ class FaceDetection::Impl {
       image.data != nullptr);
   }
 
+  /** @brief Minimum scale of the image pyramid for `img` */
+  inline float MinScale(const seeta::ImageData & img,
+      int32_t max_face_size) const {
+    int32_t min_img_size = std::min(img.width, img.height);
+    if (max_face_size > 0)
+      min_img_size = std::min(min_img_size, max_face_size);
+    return static_cast<float>(kWndSize) / min_img_size;
+  }
+
+  bool Detect(const seeta::ImageData & img, int32_t max_face_size,
+    std::vector<seeta::FaceInfo>* faces,
+    const std::chrono::steady_clock::time_point* deadline = nullptr);
+  void DetectIncremental(const seeta::ImageData & img,
+    std::vector<seeta::FaceInfo>* faces);
+  void DetectGated(const seeta::ImageData & img,
+    std::vector<seeta::FaceInfo>* faces);
+  void ApplyScoreThresh(std::vector<seeta::FaceInfo>* faces);
+
+  /** @brief Choose the levels of the image pyramid to scan for `img`. */
+  void UpdateLevelMask(const seeta::ImageData & img);
+  /** @brief Count the detections of a frame, and clear the level mask. */
+  void UpdateScaleStats(const std::vector<seeta::FaceInfo> & faces);
+  /** @brief Level of the image pyramid where `face` fits the window */
+  int32_t LevelOfFace(const seeta::FaceInfo & face, int32_t num_level) const;
+
  public:
   static const int32_t kWndSize = 40;
+  /**< Decay of the detection counts of scales by each frame */
+  static const double kScaleHitDecay;
+  /**< Decayed count of detections around a scale for it to be scanned */
+  static const double kMinScaleHits;
+  /**< Score thresholds calibrated for each detection mode */
+  static const float kModeScoreThresh[3];
 
   int32_t min_face_size_;
   int32_t max_face_size_;
@@ -65,10 +108,223 @@ class FaceDetection::Impl {
   float cls_thresh_;
 
   std::vector<seeta::FaceInfo> pos_wnds_;
+
+  /**< Buffers for detection in regions of interest */
+  std::vector<seeta::DetectionROI> rois_;
+  std::vector<uint8_t> roi_data_;
+  std::vector<seeta::FaceInfo> roi_faces_;
+  std::vector<seeta::FaceInfo> merged_faces_;
+
+  /**< Scaled images from the caller to scan */
+  std::vector<seeta::ScaledImage> scaled_images_;
+
+  /**< Batch detection of small images */
+  seeta::fd::ImageAtlas atlas_;
+  std::vector<seeta::ImageData> batch_images_;
+  std::vector<float> batch_min_scales_;
+  std::vector<int32_t> batch_index_;
+  std::vector<std::vector<seeta::FaceInfo> > batch_faces_;
+
+  /**< Motion gating for static cameras */
+  bool motion_gating_;
+  int32_t full_scan_interval_;
+  int32_t num_gated_frame_;
+  seeta::fd::MotionMask motion_mask_;
+  std::vector<seeta::FaceInfo> prev_faces_;
+
+  /**< Incremental detection over frames */
+  bool incremental_;
+  bool has_dirty_rects_;
+  std::vector<seeta::Rect> dirty_rects_;
+  std::vector<uint8_t> prev_frame_;
+  int32_t prev_frame_width_;
+  int32_t prev_frame_height_;
+  seeta::fd::CellMask dirty_mask_;
+
+  /**< Adaptive scales learned from detections over frames */
+  bool adaptive_scales_;
+  int32_t scale_scan_interval_;
+  int32_t num_adaptive_frame_;
+  int32_t next_sampled_level_;
+  std::vector<seeta::ScaleStat> scale_stats_;
+  std::vector<uint8_t> level_mask_;
+
+  /**< Whether the image pyramid is kept for the faces reported */
+  bool has_pyramid_levels_;
   std::unique_ptr<seeta::fd::Detector> detector_;
   seeta::fd::ImagePyramid img_pyramid_;
 };
 
+const double FaceDetection::Impl::kScaleHitDecay = 0.98;
+const double FaceDetection::Impl::kMinScaleHits = 0.5;
+const float FaceDetection::Impl::kModeScoreThresh[3] = { 3.85f, 135.0f, 190.0f };
+
+bool FaceDetection::Impl::Detect(const seeta::ImageData & img,
+    int32_t max_face_size, std::vector<seeta::FaceInfo>* faces,
+    const std::chrono::steady_clock::time_point* deadline) {
+  has_pyramid_levels_ = false;
+  img_pyramid_.SetImage1x(img.data, img.width, img.height);
+  img_pyramid_.SetMinScale(MinScale(img, max_face_size));
+
+  detector_->SetWindowSize(kWndSize);
+  detector_->SetSlideWindowStep(slide_wnd_step_x_, slide_wnd_step_y_);
+
+  bool is_complete = true;
+  if (deadline != nullptr)
+    is_complete = detector_->Detect(&img_pyramid_, faces, *deadline);
+  else
+    detector_->Detect(&img_pyramid_, faces);
+
+  ApplyScoreThresh(faces);
+  return is_complete;
+}
+
+void FaceDetection::Impl::ApplyScoreThresh(
+    std::vector<seeta::FaceInfo>* faces) {
+  for (int32_t i = 0; i < faces->size(); i++) {
+    if ((*faces)[i].score < cls_thresh_) {
+      faces->resize(i);
+      break;
+    }
+  }
+}
+
+void FaceDetection::Impl::UpdateLevelMask(const seeta::ImageData & img) {
+  img_pyramid_.SetMinScale(MinScale(img, max_face_size_));
+  int32_t num_level = img_pyramid_.num_level();
+  bool is_full_scan = (num_level != static_cast<int32_t>(scale_stats_.size()));
+
+  // Scales are accumulated as in the image pyramid
+  scale_stats_.resize(num_level);
+  float scale = img_pyramid_.max_scale();
+  double total_hits = 0;
+  for (int32_t level = 0; level < num_level; level++) {
+    scale_stats_[level].face_size = static_cast<int32_t>(kWndSize / scale + 0.5);
+    scale *= img_pyramid_.scale_step();
+    total_hits += scale_stats_[level].hits;
+  }
+  if (++num_adaptive_frame_ >= scale_scan_interval_ ||
+      total_hits < kMinScaleHits)
+    is_full_scan = true;
+  if (is_full_scan)
+    num_adaptive_frame_ = 0;
+
+  level_mask_.assign(num_level, (is_full_scan ? 1 : 0));
+  if (!is_full_scan) {
+    int32_t num_skipped = 0;
+    for (int32_t level = 0; level < num_level; level++) {
+      double hits = scale_stats_[level].hits;
+      if (level > 0)
+        hits += scale_stats_[level - 1].hits;
+      if (level + 1 < num_level)
+        hits += scale_stats_[level + 1].hits;
+      level_mask_[level] = (hits >= kMinScaleHits ? 1 : 0);
+      num_skipped += (1 - level_mask_[level]);
+    }
+
+    // One of the skipped levels is sampled in turn
+    for (int32_t n = 0; n < num_level && num_skipped > 0; n++) {
+      int32_t level = (next_sampled_level_ + n) % num_level;
+      if (level_mask_[level] == 0) {
+        level_mask_[level] = 1;
+        next_sampled_level_ = level + 1;
+        break;
+      }
+    }
+  }
+
+  for (int32_t level = 0; level < num_level; level++)
+    scale_stats_[level].is_scanned = (level_mask_[level] != 0);
+  img_pyramid_.SetLevelMask(level_mask_);
+}
+
+void FaceDetection::Impl::UpdateScaleStats(
+    const std::vector<seeta::FaceInfo> & faces) {
+  level_mask_.clear();
+  img_pyramid_.SetLevelMask(level_mask_);
+
+  int32_t num_level = static_cast<int32_t>(scale_stats_.size());
+  for (int32_t level = 0; level < num_level; level++)
+    scale_stats_[level].hits *= kScaleHitDecay;
+
+  for (size_t i = 0; i < faces.size(); i++) {
+    int32_t level = LevelOfFace(faces[i], num_level);
+    if (level >= 0)
+      scale_stats_[level].hits += 1.0;
+  }
+}
+
+int32_t FaceDetection::Impl::LevelOfFace(const seeta::FaceInfo & face,
+    int32_t num_level) const {
+  if (face.bbox.width <= 0 || num_level <= 0)
+    return -1;
+
+  // A face fits the window at the scale of kWndSize / its size
+  double log_step = std::log(static_cast<double>(img_pyramid_.scale_step()));
+  double scale = static_cast<double>(kWndSize) / face.bbox.width;
+  int32_t level = static_cast<int32_t>(std::floor(
+    std::log(scale / img_pyramid_.max_scale()) / log_step + 0.5));
+  return std::min(std::max(level, 0), num_level - 1);
+}
+
+void FaceDetection::Impl::DetectIncremental(const seeta::ImageData & img,
+    std::vector<seeta::FaceInfo>* faces) {
+  int32_t num_pixel = img.width * img.height;
+  bool is_new_size = (prev_frame_.empty() ||
+    img.width != prev_frame_width_ || img.height != prev_frame_height_);
+  if (is_new_size) {
+    dirty_mask_.Reset(img.width, img.height, true);
+  } else if (has_dirty_rects_) {
+    dirty_mask_.Reset(img.width, img.height, false);
+    for (size_t i = 0; i < dirty_rects_.size(); i++)
+      dirty_mask_.SetActive(dirty_rects_[i]);
+  } else {
+    dirty_mask_.Reset(img.width, img.height, false);
+    dirty_mask_.SetChanged(prev_frame_.data(), img.data);
+  }
+  has_dirty_rects_ = false;
+  dirty_rects_.clear();
+
+  prev_frame_.assign(img.data, img.data + num_pixel);
+  prev_frame_width_ = img.width;
+  prev_frame_height_ = img.height;
+
+  dirty_mask_.BuildIndex();
+  detector_->SetDirtyMask(&dirty_mask_);
+  Detect(img, max_face_size_, faces);
+  detector_->SetDirtyMask(nullptr);
+}
+
+void FaceDetection::Impl::DetectGated(const seeta::ImageData & img,
+    std::vector<seeta::FaceInfo>* faces) {
+  seeta::fd::MotionMask & motion_mask = motion_mask_;
+  bool is_full_scan = !motion_mask.Update(img) ||
+    ++num_gated_frame_ >= full_scan_interval_;
+
+  if (is_full_scan) {
+    num_gated_frame_ = 0;
+    Detect(img, max_face_size_, faces);
+  } else {
+    // Keep searching around faces which may have stopped moving
+    for (size_t i = 0; i < prev_faces_.size(); i++) {
+      seeta::Rect rect = prev_faces_[i].bbox;
+      rect.x -= rect.width / 2;
+      rect.y -= rect.height / 2;
+      rect.width *= 2;
+      rect.height *= 2;
+      motion_mask.SetActive(rect);
+    }
+
+    if (motion_mask.num_active_cell() > 0) {
+      motion_mask.BuildIndex();
+      detector_->SetMotionMask(&motion_mask);
+      Detect(img, max_face_size_, faces);
+      detector_->SetMotionMask(nullptr);
+    }
+  }
+  prev_faces_.assign(faces->begin(), faces->end());
+}
+
 FaceDetection::FaceDetection(const char* model_path)
     : impl_(new seeta::FaceDetection::Impl()) {
   impl_->detector_->LoadModel(model_path);
@@ -81,37 +337,225 @@ FaceDetection::~FaceDetection() {
 
 std::vector<seeta::FaceInfo> FaceDetection::Detect(
     const seeta::ImageData & img) {
+  Detect(img, &(impl_->pos_wnds_));
+  return impl_->pos_wnds_;
+}
+
+void FaceDetection::Detect(const seeta::ImageData & img,
+    std::vector<seeta::FaceInfo>* faces) {
+  faces->clear();
+  if (!impl_->IsLegalImage(img))
+    return;
+
+  if (impl_->adaptive_scales_)
+    impl_->UpdateLevelMask(img);
+
+  if (impl_->incremental_)
+    impl_->DetectIncremental(img, faces);
+  else if (impl_->motion_gating_)
+    impl_->DetectGated(img, faces);
+  else
+    impl_->Detect(img, impl_->max_face_size_, faces);
+
+  if (impl_->adaptive_scales_)
+    impl_->UpdateScaleStats(*faces);
+}
+
+void FaceDetection::Detect(const seeta::ImageData & img,
+    std::vector<seeta::FaceInfo>* faces,
+    std::vector<seeta::FaceLevel>* levels) {
+  impl_->has_pyramid_levels_ = false;
+  Detect(img, faces);
+  levels->clear();
+  if (faces->empty())
+    return;
+
+  // Only the levels of the faces are built in place, unless the detector has
+  // done it already. Others are built when asked for by GetPyramidLevel().
+  impl_->has_pyramid_levels_ = true;
+  int32_t num_level = impl_->img_pyramid_.num_level();
+  levels->resize(faces->size());
+  for (size_t i = 0; i < faces->size(); i++) {
+    seeta::FaceLevel & face_level = (*levels)[i];
+    face_level.level = impl_->LevelOfFace((*faces)[i], num_level);
+    GetPyramidLevel(face_level.level, &(face_level.image));
+  }
+}
+
+bool FaceDetection::GetPyramidLevel(int32_t level,
+    seeta::ScaledImage* image) const {
+  if (!impl_->has_pyramid_levels_)
+    return false;
+  impl_->img_pyramid_.BuildLevel(level);
+  float scale_factor = 0.0f;
+  const seeta::ImageData* img_scaled =
+    impl_->img_pyramid_.GetLevel(level, &scale_factor);
+  if (img_scaled == nullptr)
+    return false;
+
+  image->image = *img_scaled;
+  image->stride = img_scaled->width;
+  image->scale_factor = scale_factor;
+  return true;
+}
+
+bool FaceDetection::Detect(const seeta::ImageData & img,
+    double time_budget_ms, std::vector<seeta::FaceInfo>* faces) {
+  std::chrono::steady_clock::time_point deadline =
+    std::chrono::steady_clock::now() +
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double, std::milli>(time_budget_ms));
+
+  faces->clear();
+  if (!impl_->IsLegalImage(img))
+    return true;
+
+  return impl_->Detect(img, impl_->max_face_size_, faces, &deadline);
+}
+
+void FaceDetection::Detect(const seeta::ImageData & img,
+    const std::vector<seeta::Rect> & rois,
+    std::vector<seeta::FaceInfo>* faces) {
+  std::vector<seeta::DetectionROI> & detection_rois = impl_->rois_;
+  detection_rois.resize(rois.size());
+  for (size_t i = 0; i < rois.size(); i++) {
+    detection_rois[i].rect = rois[i];
+    detection_rois[i].min_face_size = 0;
+    detection_rois[i].max_face_size = 0;
+  }
+  Detect(img, detection_rois, faces);
+}
+
+void FaceDetection::Detect(const seeta::ImageData & img,
+    const std::vector<seeta::DetectionROI> & rois,
+    std::vector<seeta::FaceInfo>* faces) {
+  faces->clear();
+  if (!impl_->IsLegalImage(img))
+    return;
+
+  float max_scale = impl_->img_pyramid_.max_scale();
+  std::vector<seeta::FaceInfo> & roi_faces = impl_->roi_faces_;
+
+  for (size_t i = 0; i < rois.size(); i++) {
+    int32_t x1 = std::max(rois[i].rect.x, 0);
+    int32_t y1 = std::max(rois[i].rect.y, 0);
+    int32_t x2 = std::min(rois[i].rect.x + rois[i].rect.width, img.width);
+    int32_t y2 = std::min(rois[i].rect.y + rois[i].rect.height, img.height);
+    if (x2 <= x1 || y2 <= y1)
+      continue;
+
+    seeta::ImageData roi_img(x2 - x1, y2 - y1, 1);
+    if (roi_img.width == img.width && roi_img.height == img.height) {
+      roi_img.data = img.data;
+    } else {
+      impl_->roi_data_.resize(roi_img.width * roi_img.height);
+      for (int32_t r = 0; r < roi_img.height; r++) {
+        std::memcpy(impl_->roi_data_.data() + r * roi_img.width,
+          img.data + (y1 + r) * img.width + x1, roi_img.width);
+      }
+      roi_img.data = impl_->roi_data_.data();
+    }
+
+    impl_->img_pyramid_.SetMaxScale(rois[i].min_face_size >= 20 ?
+      impl_->kWndSize / static_cast<float>(rois[i].min_face_size) : max_scale);
+    impl_->Detect(roi_img, (rois[i].max_face_size > 0 ?
+      rois[i].max_face_size : impl_->max_face_size_), &roi_faces);
+
+    for (size_t j = 0; j < roi_faces.size(); j++) {
+      roi_faces[j].bbox.x += x1;
+      roi_faces[j].bbox.y += y1;
+      faces->push_back(roi_faces[j]);
+    }
+  }
+  impl_->img_pyramid_.SetMaxScale(max_scale);
+
+  if (rois.size() > 1)
+    seeta::fd::MergeOverlappedFaces(faces, 0.3f, &(impl_->merged_faces_));
+}
+
+void FaceDetection::Detect(const seeta::ImageData & img,
+    const std::vector<seeta::ScaledImage> & levels,
+    std::vector<seeta::FaceInfo>* faces) {
+  faces->clear();
   if (!impl_->IsLegalImage(img))
-    return std::vector<seeta::FaceInfo>();
+    return;
 
-  int32_t min_img_size = img.height <= img.width ? img.height : img.width;
-  min_img_size = (impl_->max_face_size_ > 0 ?
-    (min_img_size >= impl_->max_face_size_ ? impl_->max_face_size_ : min_img_size) :
-    min_img_size);
+  // Same range of scales as the internal image pyramid
+  float max_scale = impl_->img_pyramid_.max_scale();
+  float min_scale = impl_->MinScale(img, impl_->max_face_size_);
 
-  impl_->img_pyramid_.SetImage1x(img.data, img.width, img.height);
-  impl_->img_pyramid_.SetMinScale(static_cast<float>(impl_->kWndSize) / min_img_size);
+  std::vector<seeta::ScaledImage> & scaled_images = impl_->scaled_images_;
+  scaled_images.clear();
+  for (size_t i = 0; i < levels.size(); i++) {
+    const seeta::ScaledImage & level = levels[i];
+    if (level.image.data == nullptr || level.image.num_channels != 1 ||
+        level.image.width < impl_->kWndSize ||
+        level.image.height < impl_->kWndSize ||
+        level.stride < level.image.width ||
+        level.scale_factor > max_scale || level.scale_factor < min_scale)
+      continue;
+    scaled_images.push_back(level);
+  }
+  std::stable_sort(scaled_images.begin(), scaled_images.end(),
+    [](const seeta::ScaledImage & a, const seeta::ScaledImage & b) {
+      return a.scale_factor > b.scale_factor;
+    });
 
   impl_->detector_->SetWindowSize(impl_->kWndSize);
   impl_->detector_->SetSlideWindowStep(impl_->slide_wnd_step_x_,
     impl_->slide_wnd_step_y_);
+  impl_->detector_->Detect(img, scaled_images, faces);
+  impl_->ApplyScoreThresh(faces);
+}
 
-  impl_->pos_wnds_ = impl_->detector_->Detect(&(impl_->img_pyramid_));
+void FaceDetection::Detect(const std::vector<seeta::ImageData> & images,
+    std::vector<std::vector<seeta::FaceInfo> >* faces) {
+  faces->resize(images.size());
+  for (size_t i = 0; i < images.size(); i++)
+    (*faces)[i].clear();
 
-  for (int32_t i = 0; i < impl_->pos_wnds_.size(); i++) {
-    if (impl_->pos_wnds_[i].score < impl_->cls_thresh_) {
-      impl_->pos_wnds_.resize(i);
-      break;
-    }
+  // Same range of scales for each image as the internal image pyramid
+  std::vector<seeta::ImageData> & batch_images = impl_->batch_images_;
+  std::vector<float> & min_scales = impl_->batch_min_scales_;
+  batch_images.clear();
+  min_scales.clear();
+  impl_->batch_index_.clear();
+  for (size_t i = 0; i < images.size(); i++) {
+    if (!impl_->IsLegalImage(images[i]))
+      continue;
+    batch_images.push_back(images[i]);
+    min_scales.push_back(impl_->MinScale(images[i], impl_->max_face_size_));
+    impl_->batch_index_.push_back(static_cast<int32_t>(i));
   }
+  if (batch_images.empty())
+    return;
 
-  return impl_->pos_wnds_;
+  impl_->atlas_.SetMaxScale(impl_->img_pyramid_.max_scale());
+  impl_->atlas_.SetScaleStep(impl_->img_pyramid_.scale_step());
+  impl_->atlas_.SetImages(batch_images, min_scales);
+
+  impl_->detector_->SetWindowSize(impl_->kWndSize);
+  impl_->detector_->SetSlideWindowStep(impl_->slide_wnd_step_x_,
+    impl_->slide_wnd_step_y_);
+  impl_->detector_->Detect(batch_images, &(impl_->atlas_),
+    &(impl_->batch_faces_));
+  for (size_t n = 0; n < batch_images.size(); n++) {
+    impl_->ApplyScoreThresh(&(impl_->batch_faces_[n]));
+    (*faces)[impl_->batch_index_[n]].assign(impl_->batch_faces_[n].begin(),
+      impl_->batch_faces_[n].end());
+  }
+}
+
+bool FaceDetection::AddModel(const char* model_path) {
+  return impl_->detector_->LoadModel(model_path);
 }
 
 void FaceDetection::SetMinFaceSize(int32_t size) {
   if (size >= 20) {
     impl_->min_face_size_ = size;
     impl_->img_pyramid_.SetMaxScale(impl_->kWndSize / static_cast<float>(size));
+    impl_->scale_stats_.clear();
+    impl_->has_pyramid_levels_ = false;
   }
 }
 
@@ -121,8 +565,11 @@ void FaceDetection::SetMaxFaceSize(int32_t size) {
 }
 
 void FaceDetection::SetImagePyramidScaleFactor(float factor) {
-  if (factor >= 0.01f && factor <= 0.99f)
+  if (factor >= 0.01f && factor <= 0.99f) {
     impl_->img_pyramid_.SetScaleStep(static_cast<float>(factor));
+    impl_->scale_stats_.clear();
+    impl_->has_pyramid_levels_ = false;
+  }
 }
 
 void FaceDetection::SetWindowStep(int32_t step_x, int32_t step_y) {
@@ -137,4 +584,55 @@ void FaceDetection::SetScoreThresh(float thresh) {
     impl_->cls_thresh_ = thresh;
 }
 
+void FaceDetection::SetDetectionMode(seeta::DetectionMode mode) {
+  int32_t num_stage;
+  switch (mode) {
+    case seeta::DetectionMode::LAB_Stage_Only:
+      num_stage = 0;
+      break;
+    case seeta::DetectionMode::First_MLP_Stage:
+      num_stage = 1;
+      break;
+    default:
+      mode = seeta::DetectionMode::Full_Detection;
+      num_stage = -1;
+  }
+  impl_->detector_->SetMaxRefineStage(num_stage);
+  impl_->cls_thresh_ = impl_->kModeScoreThresh[mode];
+}
+
+void FaceDetection::SetMotionGating(bool enabled, int32_t full_scan_interval) {
+  impl_->motion_gating_ = enabled;
+  if (full_scan_interval > 0)
+    impl_->full_scan_interval_ = full_scan_interval;
+  impl_->num_gated_frame_ = 0;
+  impl_->prev_faces_.clear();
+}
+
+void FaceDetection::SetIncrementalDetection(bool enabled) {
+  impl_->incremental_ = enabled;
+  impl_->has_dirty_rects_ = false;
+  impl_->dirty_rects_.clear();
+  impl_->prev_frame_.clear();
+}
+
+void FaceDetection::SetDirtyRects(const std::vector<seeta::Rect> & rects) {
+  impl_->has_dirty_rects_ = true;
+  impl_->dirty_rects_.assign(rects.begin(), rects.end());
+}
+
+void FaceDetection::SetAdaptiveScales(bool enabled,
+    int32_t full_scan_interval) {
+  impl_->adaptive_scales_ = enabled;
+  if (full_scan_interval > 0)
+    impl_->scale_scan_interval_ = full_scan_interval;
+  impl_->num_adaptive_frame_ = 0;
+  impl_->next_sampled_level_ = 0;
+  impl_->scale_stats_.clear();
+}
+
+void FaceDetection::GetScaleStats(std::vector<seeta::ScaleStat>* stats) const {
+  stats->assign(impl_->scale_stats_.begin(), impl_->scale_stats_.end());
+}
+
 }  // namespace seeta
@@ -32,6 +32,7 @@
 #include "feat/lab_feature_map.h"
 
 #include <cmath>
+#include <cstring>
 
 #include "util/math_func.h"
 
@@ -40,105 +41,256 @@ namespace fd {
 
 void LABFeatureMap::Compute(const uint8_t* input, int32_t width,
     int32_t height) {
-  if (input == nullptr || width <= 0 || height <= 0) {
+  Compute(input, width, height, width);
+}
+
+void LABFeatureMap::Compute(const uint8_t* input, int32_t width,
+    int32_t height, int32_t stride) {
+  if (input == nullptr || width <= 0 || height <= 0 || stride < width) {
     return;  // @todo handle the errors!!!
   }
 
   Reshape(width, height);
-  ComputeIntegralImages(input);
+  if (stride == width) {
+    std::memcpy(img_.data(), input, width * height * sizeof(uint8_t));
+  } else {
+    for (int32_t r = 0; r < height; r++) {
+      std::memcpy(img_.data() + r * width, input + r * stride,
+        width * sizeof(uint8_t));
+    }
+  }
   ComputeRectSum();
   ComputeFeatureMap();
 }
 
-float LABFeatureMap::GetStdDev() const {
-  double mean;
-  double m2;
-  double area = roi_.width * roi_.height;
-
-  int32_t top_left;
-  int32_t top_right;
-  int32_t bottom_left;
-  int32_t bottom_right;
-
-  if (roi_.x != 0) {
-    if (roi_.y != 0) {
-      top_left = (roi_.y - 1) * width_ + roi_.x - 1;
-      top_right = top_left + roi_.width;
-      bottom_left = top_left + roi_.height * width_;
-      bottom_right = bottom_left + roi_.width;
-
-      mean = (int_img_[bottom_right] - int_img_[bottom_left] +
-        int_img_[top_left] - int_img_[top_right]) / area;
-      m2 = (square_int_img_[bottom_right] - square_int_img_[bottom_left] +
-        square_int_img_[top_left] - square_int_img_[top_right]) / area;
-    } else {
-      bottom_left = (roi_.height - 1) * width_ + roi_.x - 1;
-      bottom_right = bottom_left + roi_.width;
+float LABFeatureMap::GetStdDev(const seeta::Rect & roi) const {
+  double area = roi.width * roi.height;
+  const uint8_t* src = img_.data() + roi.y * width_ + roi.x;
+  // The sums are kept in 64 bits, so windows of any size are exact.
+  int64_t sum = 0;
+  uint64_t square_sum = 0;
 
-      mean = (int_img_[bottom_right] - int_img_[bottom_left]) / area;
-      m2 = (square_int_img_[bottom_right] - square_int_img_[bottom_left]) / area;
+#ifdef USE_SSE
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sum_epi64 = zero;
+  __m128i square_sum_epi64 = zero;
+#endif
+  for (int32_t r = 0; r < roi.height; r++, src += width_) {
+    int32_t c = 0;
+#ifdef USE_SSE
+    // Squares of one row are summed in 32-bit lanes first, each of which takes
+    // at most 4 * 255 * 255 per 16 pixels, and then widened to 64 bits.
+    __m128i row_square_sum_epi32 = zero;
+    for (; c + 16 <= roi.width; c += 16) {
+      __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + c));
+      __m128i x_lo = _mm_unpacklo_epi8(x, zero);
+      __m128i x_hi = _mm_unpackhi_epi8(x, zero);
+      sum_epi64 = _mm_add_epi64(sum_epi64, _mm_sad_epu8(x, zero));
+      row_square_sum_epi32 = _mm_add_epi32(row_square_sum_epi32,
+        _mm_add_epi32(_mm_madd_epi16(x_lo, x_lo), _mm_madd_epi16(x_hi, x_hi)));
     }
-  } else {
-    if (roi_.y != 0) {
-      top_right = (roi_.y - 1) * width_ + roi_.width - 1;
-      bottom_right = top_right + roi_.height * width_;
-
-      mean = (int_img_[bottom_right] - int_img_[top_right]) / area;
-      m2 = (square_int_img_[bottom_right] - square_int_img_[top_right]) / area;
-    } else {
-      bottom_right = (roi_.height - 1) * width_ + roi_.width - 1;
-      mean = int_img_[bottom_right] / area;
-      m2 = square_int_img_[bottom_right] / area;
+    square_sum_epi64 = _mm_add_epi64(square_sum_epi64,
+      _mm_add_epi64(_mm_unpacklo_epi32(row_square_sum_epi32, zero),
+      _mm_unpackhi_epi32(row_square_sum_epi32, zero)));
+#endif
+    for (; c < roi.width; c++) {
+      int32_t val = static_cast<int32_t>(src[c]);
+      sum += val;
+      square_sum += static_cast<uint64_t>(val * val);
     }
   }
+#ifdef USE_SSE
+  int64_t sums[2];
+  uint64_t square_sums[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), sum_epi64);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(square_sums), square_sum_epi64);
+  sum += sums[0] + sums[1];
+  square_sum += square_sums[0] + square_sums[1];
+#endif
 
+  double mean = sum / area;
+  double m2 = square_sum / area;
   return static_cast<float>(std::sqrt(m2 - mean * mean));
 }
 
+void LABFeatureMap::GetStdDevMask(int32_t wnd_width, int32_t wnd_height,
+    int32_t step_x, int32_t step_y, float thresh, std::vector<uint8_t>* mask) {
+  mask->clear();
+  if (wnd_width > width_ || wnd_height > height_ || step_x <= 0 || step_y <= 0)
+    return;
+
+  int32_t num_wnd_x = (width_ - wnd_width) / step_x + 1;
+  int32_t num_wnd_y = (height_ - wnd_height) / step_y + 1;
+  int32_t num_col = width_ - wnd_width + 1;
+  mask->resize(num_wnd_x * num_wnd_y);
+
+  col_sum_buf_.assign(width_, 0);
+  col_square_sum_buf_.assign(width_, 0);
+  row_sum_buf_.resize(width_);
+  row_square_sum_buf_.resize(width_);
+  wnd_sum_buf_.resize(num_col);
+  wnd_square_sum_buf_.resize(num_col);
+
+  const int32_t* col_sum = col_sum_buf_.data();
+  const uint32_t* col_square_sum = col_square_sum_buf_.data();
+  int32_t* row_sum = row_sum_buf_.data();
+  uint32_t* row_square_sum_u32 = row_square_sum_buf_.data();
+  // The square sums are accumulated modulo 2^32, which is exact as long as the
+  // sum of a window fits in 31 bits (see IsStdDevMaskExact()).
+  const int32_t* row_square_sum =
+    reinterpret_cast<const int32_t*>(row_square_sum_u32);
+  int32_t* wnd_sum = wnd_sum_buf_.data();
+  int32_t* wnd_square_sum = wnd_square_sum_buf_.data();
+  const double area = wnd_width * wnd_height;
+  uint8_t* dest = mask->data();
+
+  // Rows in [top, bottom) are accumulated in the column sums
+  int32_t top = 0;
+  int32_t bottom = 0;
+  for (int32_t r = 0; r < num_wnd_y; r++) {
+    int32_t y = r * step_y;
+
+    // Sums of the rows covered by the windows, per column
+    if (y >= bottom) {
+      col_sum_buf_.assign(width_, 0);
+      col_square_sum_buf_.assign(width_, 0);
+      top = bottom = y;
+    }
+    for (; top < y; top++)
+      UpdateColSum<false>(top);
+    for (; bottom < y + wnd_height; bottom++)
+      UpdateColSum<true>(bottom);
+
+    row_sum[0] = col_sum[0];
+    row_square_sum_u32[0] = col_square_sum[0];
+    for (int32_t c = 1; c < width_; c++) {
+      row_sum[c] = row_sum[c - 1] + col_sum[c];
+      row_square_sum_u32[c] = row_square_sum_u32[c - 1] + col_square_sum[c];
+    }
+
+    // Sums of the windows at every horizontal position
+    wnd_sum[0] = row_sum[wnd_width - 1];
+    wnd_square_sum[0] = row_square_sum[wnd_width - 1];
+    seeta::fd::MathFunction::VectorSub(row_sum + wnd_width, row_sum,
+      wnd_sum + 1, num_col - 1);
+    seeta::fd::MathFunction::VectorSub(row_square_sum + wnd_width,
+      row_square_sum, wnd_square_sum + 1, num_col - 1);
+
+    int32_t c = 0;
+#ifdef USE_SSE
+    const __m128d area_pd = _mm_set1_pd(area);
+    const __m128 thresh_ps = _mm_set1_ps(thresh);
+    for (; c < num_wnd_x - 1; c += 2) {
+      int32_t x1 = c * step_x;
+      int32_t x2 = x1 + step_x;
+      __m128d mean = _mm_div_pd(_mm_set_pd(wnd_sum[x2], wnd_sum[x1]), area_pd);
+      __m128d m2 = _mm_div_pd(
+        _mm_set_pd(wnd_square_sum[x2], wnd_square_sum[x1]), area_pd);
+      __m128 std_dev = _mm_cvtpd_ps(
+        _mm_sqrt_pd(_mm_sub_pd(m2, _mm_mul_pd(mean, mean))));
+      int32_t is_pos = _mm_movemask_ps(_mm_cmpgt_ps(std_dev, thresh_ps));
+      *(dest++) = static_cast<uint8_t>(is_pos & 0x1);
+      *(dest++) = static_cast<uint8_t>((is_pos >> 1) & 0x1);
+    }
+#endif
+    for (; c < num_wnd_x; c++) {
+      int32_t x = c * step_x;
+      double mean = wnd_sum[x] / area;
+      double m2 = wnd_square_sum[x] / area;
+      float std_dev = static_cast<float>(std::sqrt(m2 - mean * mean));
+      *(dest++) = (std_dev > thresh ? 1 : 0);
+    }
+  }
+}
+
 void LABFeatureMap::Reshape(int32_t width, int32_t height) {
   width_ = width;
   height_ = height;
 
   int32_t len = width_ * height_;
+  img_.resize(len);
   feat_map_.resize(len);
   rect_sum_.resize(len);
-  int_img_.resize(len);
-  square_int_img_.resize(len);
-}
-
-void LABFeatureMap::ComputeIntegralImages(const uint8_t* input) {
-  int32_t len = width_ * height_;
-
-  seeta::fd::MathFunction::UInt8ToInt32(input, int_img_.data(), len);
-  seeta::fd::MathFunction::Square(int_img_.data(), square_int_img_.data(), len);
-  Integral(int_img_.data());
-  Integral(square_int_img_.data());
 }
 
 void LABFeatureMap::ComputeRectSum() {
-  int32_t width = width_ - rect_width_;
-  int32_t height = height_ - rect_height_;
-  const int32_t* int_img = int_img_.data();
-  int32_t* rect_sum = rect_sum_.data();
-
-  *rect_sum = *(int_img + (rect_height_ - 1) * width_ + rect_width_ - 1);
-  seeta::fd::MathFunction::VectorSub(int_img + (rect_height_ - 1) * width_ +
-    rect_width_, int_img + (rect_height_ - 1) * width_, rect_sum + 1, width);
+  int32_t width = width_ - rect_width_ + 1;
+  int32_t height = height_ - rect_height_ + 1;
+  const uint8_t* img = img_.data();
+  uint16_t* rect_sum = rect_sum_.data();
 
+  // Each 3x3 sum is taken straight from the pixels in 16-bit lanes.
 #pragma omp parallel num_threads(SEETA_NUM_THREADS)
   {
 #pragma omp for nowait
-    for (int32_t i = 1; i <= height; i++) {
-      const int32_t* top_left = int_img + (i - 1) * width_;
-      const int32_t* top_right = top_left + rect_width_ - 1;
-      const int32_t* bottom_left = top_left + rect_height_ * width_;
-      const int32_t* bottom_right = bottom_left + rect_width_ - 1;
-      int32_t* dest = rect_sum + i * width_;
-
-      *(dest++) = (*bottom_right) - (*top_right);
-      seeta::fd::MathFunction::VectorSub(bottom_right + 1, top_right + 1, dest, width);
-      seeta::fd::MathFunction::VectorSub(dest, bottom_left, dest, width);
-      seeta::fd::MathFunction::VectorAdd(dest, top_left, dest, width);
+    for (int32_t r = 0; r < height; r++) {
+      const uint8_t* src = img + r * width_;
+      uint16_t* dest = rect_sum + r * width_;
+      int32_t c = 0;
+#ifdef USE_SSE
+      for (; c + 8 <= width; c += 8) {
+        __m128i s = _mm_setzero_si128();
+        for (int32_t i = 0; i < rect_height_; i++) {
+          for (int32_t j = 0; j < rect_width_; j++) {
+            s = _mm_add_epi16(s, _mm_cvtepu8_epi16(_mm_loadl_epi64(
+              reinterpret_cast<const __m128i*>(src + i * width_ + c + j))));
+          }
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + c), s);
+      }
+#endif
+      for (; c < width; c++) {
+        int32_t s = 0;
+        for (int32_t i = 0; i < rect_height_; i++) {
+          for (int32_t j = 0; j < rect_width_; j++)
+            s += src[i * width_ + c + j];
+        }
+        dest[c] = static_cast<uint16_t>(s);
+      }
+    }
+  }
+}
+
+template<bool kAdd>
+void LABFeatureMap::UpdateColSum(int32_t r) {
+  const uint8_t* src = img_.data() + r * width_;
+  int32_t* col_sum = col_sum_buf_.data();
+  uint32_t* col_square_sum = col_square_sum_buf_.data();
+  int32_t c = 0;
+#ifdef USE_SSE
+  const __m128i zero = _mm_setzero_si128();
+  for (; c + 8 <= width_; c += 8) {
+    __m128i x = _mm_cvtepu8_epi16(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + c)));
+    // 255 * 255 still fits in an unsigned 16-bit lane
+    __m128i x2 = _mm_mullo_epi16(x, x);
+    __m128i* sum = reinterpret_cast<__m128i*>(col_sum + c);
+    __m128i* square_sum = reinterpret_cast<__m128i*>(col_square_sum + c);
+    __m128i v[4] = {
+      _mm_unpacklo_epi16(x, zero), _mm_unpackhi_epi16(x, zero),
+      _mm_unpacklo_epi16(x2, zero), _mm_unpackhi_epi16(x2, zero)
+    };
+    __m128i a[4] = {
+      _mm_loadu_si128(sum), _mm_loadu_si128(sum + 1),
+      _mm_loadu_si128(square_sum), _mm_loadu_si128(square_sum + 1)
+    };
+    for (int32_t i = 0; i < 4; i++)
+      a[i] = (kAdd ? _mm_add_epi32(a[i], v[i]) : _mm_sub_epi32(a[i], v[i]));
+    _mm_storeu_si128(sum, a[0]);
+    _mm_storeu_si128(sum + 1, a[1]);
+    _mm_storeu_si128(square_sum, a[2]);
+    _mm_storeu_si128(square_sum + 1, a[3]);
+  }
+#endif
+  for (; c < width_; c++) {
+    int32_t val = static_cast<int32_t>(src[c]);
+    uint32_t square = static_cast<uint32_t>(val * val);
+    if (kAdd) {
+      col_sum[c] += val;
+      col_square_sum[c] += square;
+    } else {
+      col_sum[c] -= val;
+      col_square_sum[c] -= square;
     }
   }
 }
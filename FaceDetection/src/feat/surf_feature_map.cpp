@@ -111,8 +111,12 @@ void SURFFeatureMap::Compute(const uint8_t* input, int32_t width,
     return;  // @todo handle the error!
   }
   Reshape(width, height);
+#ifdef USE_SSE
+  ComputeIntegralImages(input);
+#else
   ComputeGradientImages(input);
   ComputeIntegralImages();
+#endif
 }
 
 void SURFFeatureMap::GetFeatureVector(int32_t feat_id, float* feat_vec) {
@@ -153,12 +157,147 @@ void SURFFeatureMap::Reshape(int32_t width, int32_t height) {
   height_ = height;
 
   int32_t len = width_ * height_;
+  int_img_.resize(len * kNumIntChannel);
+#ifdef USE_SSE
+  grad_x_row_.resize(width_);
+  grad_y_row_.resize(width_);
+#else
   grad_x_.resize(len);
   grad_y_.resize(len);
-  int_img_.resize(len * kNumIntChannel);
   img_buf_.resize(len);
+#endif
 }
 
+#ifdef USE_SSE
+void SURFFeatureMap::ComputeIntegralImages(const uint8_t* input) {
+  const __m128i zero = _mm_setzero_si128();
+  const int16_t* dx = grad_x_row_.data();
+  const int16_t* dy = grad_y_row_.data();
+  int32_t* dest = int_img_.data();
+  const int32_t* dest_above = dest;
+  __m128i lo[4];  /**< channel 0~3 of 4 pixels */
+  __m128i hi[4];  /**< channel 4~7 of 4 pixels */
+
+  for (int32_t r = 0; r < height_; r++) {
+    ComputeGradientRow(input, r);
+
+    __m128i sum_lo = zero;
+    __m128i sum_hi = zero;
+    for (int32_t c = 0; c < width_; c += 4) {
+      int32_t num_pixel = (width_ - c >= 4 ? 4 : width_ - c);
+      __m128i gx;
+      __m128i gy;
+      if (num_pixel == 4) {
+        gx = _mm_cvtepi16_epi32(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i*>(dx + c)));
+        gy = _mm_cvtepi16_epi32(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i*>(dy + c)));
+      } else {
+        int32_t buf_x[4] = {0, 0, 0, 0};
+        int32_t buf_y[4] = {0, 0, 0, 0};
+        for (int32_t i = 0; i < num_pixel; i++) {
+          buf_x[i] = dx[c + i];
+          buf_y[i] = dy[c + i];
+        }
+        gx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf_x));
+        gy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf_y));
+      }
+
+      // Channels 0~3: dx, |dx| where dy >= 0, and dx, |dx| where dy < 0;
+      // channels 4~7: dy, |dy| where dx >= 0, and dy, |dy| where dx < 0.
+      __m128i gx_abs = _mm_abs_epi32(gx);
+      __m128i gy_abs = _mm_abs_epi32(gy);
+      __m128i gx_neg = _mm_cmplt_epi32(gx, zero);
+      __m128i gy_neg = _mm_cmplt_epi32(gy, zero);
+
+      __m128i t0 = _mm_unpacklo_epi32(_mm_andnot_si128(gy_neg, gx),
+        _mm_andnot_si128(gy_neg, gx_abs));
+      __m128i t1 = _mm_unpacklo_epi32(_mm_and_si128(gy_neg, gx),
+        _mm_and_si128(gy_neg, gx_abs));
+      __m128i t2 = _mm_unpackhi_epi32(_mm_andnot_si128(gy_neg, gx),
+        _mm_andnot_si128(gy_neg, gx_abs));
+      __m128i t3 = _mm_unpackhi_epi32(_mm_and_si128(gy_neg, gx),
+        _mm_and_si128(gy_neg, gx_abs));
+      lo[0] = _mm_unpacklo_epi64(t0, t1);
+      lo[1] = _mm_unpackhi_epi64(t0, t1);
+      lo[2] = _mm_unpacklo_epi64(t2, t3);
+      lo[3] = _mm_unpackhi_epi64(t2, t3);
+
+      t0 = _mm_unpacklo_epi32(_mm_andnot_si128(gx_neg, gy),
+        _mm_andnot_si128(gx_neg, gy_abs));
+      t1 = _mm_unpacklo_epi32(_mm_and_si128(gx_neg, gy),
+        _mm_and_si128(gx_neg, gy_abs));
+      t2 = _mm_unpackhi_epi32(_mm_andnot_si128(gx_neg, gy),
+        _mm_andnot_si128(gx_neg, gy_abs));
+      t3 = _mm_unpackhi_epi32(_mm_and_si128(gx_neg, gy),
+        _mm_and_si128(gx_neg, gy_abs));
+      hi[0] = _mm_unpacklo_epi64(t0, t1);
+      hi[1] = _mm_unpackhi_epi64(t0, t1);
+      hi[2] = _mm_unpacklo_epi64(t2, t3);
+      hi[3] = _mm_unpackhi_epi64(t2, t3);
+
+      // Cumulative sum along the row, plus integral of the row above
+      for (int32_t i = 0; i < num_pixel; i++) {
+        sum_lo = _mm_add_epi32(sum_lo, lo[i]);
+        sum_hi = _mm_add_epi32(sum_hi, hi[i]);
+        if (r != 0) {
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_add_epi32(
+            sum_lo, _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest_above))));
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 4), _mm_add_epi32(
+            sum_hi, _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(dest_above + 4))));
+          dest_above += kNumIntChannel;
+        } else {
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), sum_lo);
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 4), sum_hi);
+        }
+        dest += kNumIntChannel;
+      }
+    }
+  }
+}
+
+void SURFFeatureMap::ComputeGradientRow(const uint8_t* input, int32_t r) {
+  const uint8_t* src = input + r * width_;
+  const uint8_t* src_above = (r != 0 ? src - width_ : src);
+  const uint8_t* src_below = (r != height_ - 1 ? src + width_ : src);
+  bool is_border = (r == 0 || r == height_ - 1);
+  int16_t* dx = grad_x_row_.data();
+  int16_t* dy = grad_y_row_.data();
+  int32_t c;
+
+  // Vertical gradient, doubled at the first and last rows
+  for (c = 0; c + 8 <= width_; c += 8) {
+    __m128i below = _mm_cvtepu8_epi16(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src_below + c)));
+    __m128i above = _mm_cvtepu8_epi16(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src_above + c)));
+    __m128i diff = _mm_sub_epi16(below, above);
+    if (is_border)
+      diff = _mm_add_epi16(diff, diff);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dy + c), diff);
+  }
+  for (; c < width_; c++) {
+    dy[c] = static_cast<int16_t>((src_below[c] - src_above[c]) *
+      (is_border ? 2 : 1));
+  }
+
+  // Horizontal gradient, doubled at the first and last columns
+  dx[0] = static_cast<int16_t>((src[1] - src[0]) * 2);
+  for (c = 1; c + 9 <= width_; c += 8) {
+    __m128i right = _mm_cvtepu8_epi16(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + c + 1)));
+    __m128i left = _mm_cvtepu8_epi16(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + c - 1)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dx + c),
+      _mm_sub_epi16(right, left));
+  }
+  for (; c < width_ - 1; c++)
+    dx[c] = static_cast<int16_t>(src[c + 1] - src[c - 1]);
+  dx[width_ - 1] = static_cast<int16_t>((src[width_ - 1] - src[width_ - 2]) * 2);
+}
+#else
+
 void SURFFeatureMap::ComputeGradientImages(const uint8_t* input) {
   int32_t len = width_ * height_;
   seeta::fd::MathFunction::UInt8ToInt32(input, img_buf_.data(), len);
@@ -224,31 +363,6 @@ void SURFFeatureMap::MaskIntegralChannel() {
   const int32_t* grad_x = grad_x_.data();
   const int32_t* grad_y = grad_y_.data();
   int32_t len = width_ * height_;
-#ifdef USE_SSE
-  __m128i dx;
-  __m128i dy;
-  __m128i dx_mask;
-  __m128i dy_mask;
-  __m128i zero = _mm_set1_epi32(0);
-  __m128i xor_bits = _mm_set_epi32(0x0, 0x0, 0xffffffff, 0xffffffff);
-  __m128i data;
-  __m128i result;
-  __m128i* src = reinterpret_cast<__m128i*>(int_img_.data());
-
-  for (int32_t i = 0; i < len; i++) {
-    dx = _mm_set1_epi32(*(grad_x++));
-    dy = _mm_set1_epi32(*(grad_y++));
-    dx_mask = _mm_xor_si128(_mm_cmplt_epi32(dx, zero), xor_bits);
-    dy_mask = _mm_xor_si128(_mm_cmplt_epi32(dy, zero), xor_bits);
-
-    data = _mm_loadu_si128(src);
-    result = _mm_and_si128(data, dy_mask);
-    _mm_storeu_si128(src++, result);
-    data = _mm_loadu_si128(src);
-    result = _mm_and_si128(data, dx_mask);
-    _mm_storeu_si128(src++, result);
-  }
-#else
   int32_t dx, dy, dx_mask, dy_mask, cmp;
   int32_t xor_bits[] = {-1, -1, 0, 0};
 
@@ -273,7 +387,6 @@ void SURFFeatureMap::MaskIntegralChannel() {
           src++;
       }
   }
-#endif
 }
 
 void SURFFeatureMap::Integral() {
@@ -291,6 +404,8 @@ void SURFFeatureMap::Integral() {
     VectorCumAdd(data + r * len, len, kNumIntChannel);
 }
 
+#endif
+
 void SURFFeatureMap::VectorCumAdd(int32_t* x, int32_t len,
     int32_t num_channel) {
 #ifdef USE_SSE
@@ -31,6 +31,7 @@
 
 #include "fust.h"
 
+#include <cstring>
 #include <map>
 #include <memory>
 #include <string>
@@ -47,6 +48,26 @@
 namespace seeta {
 namespace fd {
 
+const float FuStDetector::kScanTimeRatio = 0.7f;
+
+namespace {
+
+#ifdef USE_OPENMP
+const int32_t kNumThread = SEETA_NUM_THREADS;
+#else
+const int32_t kNumThread = 1;
+#endif
+
+inline int32_t GetThreadId() {
+#ifdef USE_OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+}  // namespace
+
 bool FuStDetector::LoadModel(const std::string & model_path) {
   std::ifstream model_file(model_path, std::ifstream::binary);
   bool is_loaded = true;
@@ -114,76 +135,794 @@ bool FuStDetector::LoadModel(const std::string & model_path) {
     model_file.close();
   }
 
+  if (is_loaded) {
+    CheckStdDevMask();
+    CheckFirstLevelLAB();
+  }
+
   return is_loaded;
 }
 
 std::vector<seeta::FaceInfo> FuStDetector::Detect(
     seeta::fd::ImagePyramid* img_pyramid) {
-  float score;
-  seeta::FaceInfo wnd_info;
-  seeta::Rect wnd;
+  std::vector<seeta::FaceInfo> faces;
+  Detect(img_pyramid, &faces);
+  return faces;
+}
+
+void FuStDetector::Detect(seeta::fd::ImagePyramid* img_pyramid,
+    std::vector<seeta::FaceInfo>* faces) {
+#ifdef USE_OPENMP
+  // With motion or dirty masks only parts of each level are scanned, which
+  // is left to the plain loop below.
+  if (motion_mask_ == nullptr && dirty_mask_ == nullptr &&
+      is_first_level_lab_) {
+    DetectParallel(img_pyramid, faces);
+    return;
+  }
+#endif
+
   float scale_factor = 0.0;
   const seeta::ImageData* img_scaled =
     img_pyramid->GetNextScaleImage(&scale_factor);
 
+  ClearProposals();
+  while (img_scaled != nullptr) {
+    ScanLevel(*img_scaled, scale_factor);
+    img_scaled = img_pyramid->GetNextScaleImage(&scale_factor);
+  }
+  RefineProposals(img_pyramid->image1x(), faces);
+}
+
+#ifdef USE_OPENMP
+void FuStDetector::DetectParallel(seeta::fd::ImagePyramid* img_pyramid,
+    std::vector<seeta::FaceInfo>* faces) {
+  // Scanning is timed from here rather than from ClearProposals() below
+  std::chrono::steady_clock::time_point scan_start;
+  if (profile_ != nullptr)
+    scan_start = std::chrono::steady_clock::now();
+
+  // All scaled images are resident, so that bands of any level can be scanned
+  img_pyramid->BuildLevels();
+  int32_t num_level = img_pyramid->num_level();
+  level_images_.resize(num_level);
+  level_scales_.resize(num_level);
+  for (int32_t level = 0; level < num_level; level++) {
+    level_images_[level] =
+      *(img_pyramid->GetLevel(level, &(level_scales_[level])));
+    // Skipped levels get no tasks, as if they were smaller than a window
+    if (!img_pyramid->is_level_enabled(level))
+      level_images_[level].width = level_images_[level].height = 0;
+  }
+
+  PlanScanTasks();
+  int32_t num_task = static_cast<int32_t>(scan_tasks_.size());
+  task_proposals_.resize(num_task);
+  for (int32_t t = 0; t < num_task; t++) {
+    task_proposals_[t].resize(hierarchy_size_[0]);
+    for (int32_t i = 0; i < hierarchy_size_[0]; i++)
+      task_proposals_[t][i].clear();
+  }
+  if (band_feat_maps_.empty()) {
+    band_feat_maps_.resize(kNumThread);
+    for (int32_t i = 0; i < kNumThread; i++)
+      band_feat_maps_[i].reset(new seeta::fd::LABFeatureMap());
+    band_std_dev_mask_.resize(kNumThread);
+  }
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(SEETA_NUM_THREADS)
+  for (int32_t n = 0; n < num_task; n++) {
+    int32_t t = task_order_[n];
+    int32_t thread_id = GetThreadId();
+    ScanBand(scan_tasks_[t], band_feat_maps_[thread_id].get(),
+      &(band_std_dev_mask_[thread_id]), &(task_proposals_[t]));
+  }
+
+  // Tasks are stored by level and band, i.e. in raster order of windows
+  ClearProposals();
+  if (profile_ != nullptr)
+    scan_start_ = scan_start;
+  int32_t t = 0;
+  for (int32_t level = 0; level < num_level; level++) {
+    for (int32_t i = 0; i < hierarchy_size_[0]; i++)
+      level_proposal_begin_[i].push_back(proposals_[i].size());
+    for (; t < num_task && scan_tasks_[t].level == level; t++) {
+      for (int32_t i = 0; i < hierarchy_size_[0]; i++) {
+        proposals_[i].insert(proposals_[i].end(),
+          task_proposals_[t][i].begin(), task_proposals_[t][i].end());
+      }
+    }
+  }
+  RefineProposals(img_pyramid->image1x(), faces);
+}
+
+void FuStDetector::PlanScanTasks() {
+  int32_t num_level = static_cast<int32_t>(level_images_.size());
+  std::vector<int32_t> geometry = {
+    wnd_size_, slide_wnd_step_x_, slide_wnd_step_y_ };
+  for (int32_t level = 0; level < num_level; level++) {
+    geometry.push_back(level_images_[level].width);
+    geometry.push_back(level_images_[level].height);
+  }
+  if (geometry == scan_task_geometry_)
+    return;
+  scan_task_geometry_.swap(geometry);
+
+  int32_t min_num_row = std::max(wnd_size_ / slide_wnd_step_y_, 1);
+
+  // Cost of a band is estimated by the pixels of its feature map and the
+  // number of its windows, both known from the level size and the steps.
+  auto band_cost = [this](int32_t width, int32_t num_row) {
+    int32_t num_wnd_x = (width - wnd_size_) / slide_wnd_step_x_ + 1;
+    int64_t height = (num_row - 1) * slide_wnd_step_y_ + wnd_size_;
+    return height * width + static_cast<int64_t>(num_wnd_x) * num_row *
+      kScanWindowCost;
+  };
+
+  int64_t total_cost = 0;
+  for (int32_t level = 0; level < num_level; level++) {
+    const seeta::ImageData & img = level_images_[level];
+    int32_t num_wnd_y = (img.height - wnd_size_) / slide_wnd_step_y_ + 1;
+    if (img.width >= wnd_size_ && num_wnd_y > 0)
+      total_cost += band_cost(img.width, num_wnd_y);
+  }
+  int64_t task_cost = std::max<int64_t>(
+    total_cost / (SEETA_NUM_THREADS * kNumScanTaskPerThread), 1);
+
+  scan_tasks_.clear();
+  for (int32_t level = 0; level < num_level; level++) {
+    const seeta::ImageData & img = level_images_[level];
+    int32_t num_wnd_y = (img.height - wnd_size_) / slide_wnd_step_y_ + 1;
+    if (img.width < wnd_size_ || num_wnd_y <= 0)
+      continue;
+
+    // Bands overlap by the window height less one step, so they are kept
+    // tall enough for the overlap not to dominate.
+    int64_t num_band = (band_cost(img.width, num_wnd_y) + task_cost - 1) /
+      task_cost;
+    num_band = std::min<int64_t>(num_band, num_wnd_y / min_num_row);
+    num_band = std::max<int64_t>(num_band, 1);
+    int32_t num_row = static_cast<int32_t>(
+      (num_wnd_y + num_band - 1) / num_band);
+
+    for (int32_t r = 0; r < num_wnd_y; r += num_row) {
+      ScanTask task;
+      task.level = level;
+      task.row_begin = r;
+      task.row_end = std::min(r + num_row, num_wnd_y);
+      task.cost = band_cost(img.width, task.row_end - task.row_begin);
+      scan_tasks_.push_back(task);
+    }
+  }
+
+  // The most expensive tasks are handed out first, so that threads finish
+  // together with cheap tasks filling in at the end.
+  task_order_.resize(scan_tasks_.size());
+  for (size_t t = 0; t < task_order_.size(); t++)
+    task_order_[t] = static_cast<int32_t>(t);
+  std::stable_sort(task_order_.begin(), task_order_.end(),
+    [this](int32_t a, int32_t b) {
+      return scan_tasks_[a].cost > scan_tasks_[b].cost;
+    });
+}
+#endif
+
+void FuStDetector::ScanBand(const ScanTask & task,
+    seeta::fd::LABFeatureMap* feat_map, std::vector<uint8_t>* std_dev_mask,
+    std::vector<std::vector<seeta::FaceInfo> >* proposals) {
+  const seeta::ImageData & img = level_images_[task.level];
+  float scale_factor = level_scales_[task.level];
+  int32_t y_begin = task.row_begin * slide_wnd_step_y_;
+  int32_t num_row = task.row_end - task.row_begin;
+  int32_t height = (num_row - 1) * slide_wnd_step_y_ + wnd_size_;
+  int32_t num_wnd_x = (img.width - wnd_size_) / slide_wnd_step_x_ + 1;
+
+  feat_map->Compute(img.data + y_begin * img.width, img.width, height);
+  if (use_std_dev_mask_) {
+    feat_map->GetStdDevMask(wnd_size_, wnd_size_, slide_wnd_step_x_,
+      slide_wnd_step_y_, std_dev_thresh_, std_dev_mask);
+  }
+
+  float score;
+  seeta::FaceInfo wnd_info;
+  seeta::Rect wnd;
   wnd.height = wnd.width = wnd_size_;
+  wnd_info.bbox.width = static_cast<int32_t>(wnd_size_ / scale_factor + 0.5);
+  wnd_info.bbox.height = wnd_info.bbox.width;
 
-  // Sliding window
+  for (int32_t r = 0; r < num_row; r++) {
+    const uint8_t* mask = (use_std_dev_mask_ ?
+      std_dev_mask->data() + r * num_wnd_x : nullptr);
+    wnd.y = r * slide_wnd_step_y_;
+    wnd_info.bbox.y =
+      static_cast<int32_t>((wnd.y + y_begin) / scale_factor + 0.5);
+    for (int32_t c = 0; c < num_wnd_x; c++) {
+      if (use_std_dev_mask_ && mask[c] == 0)
+        continue;
 
-  std::vector<std::vector<seeta::FaceInfo> > proposals(hierarchy_size_[0]);
+      wnd.x = c * slide_wnd_step_x_;
+      wnd_info.bbox.x = static_cast<int32_t>(wnd.x / scale_factor + 0.5);
+      for (int32_t i = 0; i < hierarchy_size_[0]; i++) {
+        const seeta::fd::LABBoostedClassifier* classifier =
+          static_cast<const seeta::fd::LABBoostedClassifier*>(model_[i].get());
+        if (classifier->Classify(*feat_map, wnd, &score,
+            !use_std_dev_mask_)) {
+          wnd_info.score = static_cast<double>(score);
+          (*proposals)[i].push_back(wnd_info);
+        }
+      }
+    }
+  }
+}
+
+bool FuStDetector::Detect(seeta::fd::ImagePyramid* img_pyramid,
+    std::vector<seeta::FaceInfo>* faces,
+    const std::chrono::steady_clock::time_point & deadline) {
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point scan_deadline = start +
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    (deadline - start) * kScanTimeRatio);
+  bool is_complete = true;
+
+  ClearProposals();
+  for (int32_t level = img_pyramid->num_level() - 1; level >= 0; level--) {
+    if (std::chrono::steady_clock::now() >= scan_deadline) {
+      is_complete = false;
+      break;
+    }
+    if (!img_pyramid->is_level_enabled(level))
+      continue;
+    float scale_factor = 0.0f;
+    const seeta::ImageData* img_scaled =
+      img_pyramid->GetScaleImage(level, &scale_factor);
+    ScanLevel(*img_scaled, scale_factor);
+  }
+  if (is_complete)
+    ReverseLevelOrder();
+
+  return RefineProposals(img_pyramid->image1x(), faces, &deadline) &&
+    is_complete;
+}
+
+void FuStDetector::Detect(const seeta::ImageData & img,
+    const std::vector<seeta::ScaledImage> & levels,
+    std::vector<seeta::FaceInfo>* faces) {
+  ClearProposals();
+  for (size_t i = 0; i < levels.size(); i++)
+    ScanLevel(levels[i]);
+  RefineProposals(img, faces);
+}
+
+void FuStDetector::Detect(const std::vector<seeta::ImageData> & images,
+    seeta::fd::ImageAtlas* atlas,
+    std::vector<std::vector<seeta::FaceInfo> >* faces) {
+  int32_t num_image = static_cast<int32_t>(images.size());
+  atlas->SetWindow(wnd_size_, slide_wnd_step_x_, slide_wnd_step_y_);
+  ClearBatchProposals(num_image);
+
+  float scale_factor = 0.0f;
+  const seeta::ImageData* atlas_img = atlas->GetNextLevel(&scale_factor);
+  while (atlas_img != nullptr) {
+    ScanAtlasLevel(*atlas_img, scale_factor, atlas->tiles());
+    atlas_img = atlas->GetNextLevel(&scale_factor);
+  }
+
+  faces->resize(num_image);
+  for (int32_t n = 0; n < num_image; n++)
+    RefineBatchProposals(n, images[n], &((*faces)[n]));
+}
+
+void FuStDetector::ClearProposals() {
+  if (profile_ != nullptr)
+    scan_start_ = std::chrono::steady_clock::now();
+  cache_frame_id_++;
+  proposals_.resize(hierarchy_size_[0]);
+  level_proposal_begin_.resize(hierarchy_size_[0]);
+  for (int32_t i = 0; i < hierarchy_size_[0]; i++) {
+    proposals_[i].clear();
+    level_proposal_begin_[i].clear();
+  }
+}
+
+void FuStDetector::ReverseLevelOrder() {
+  proposals_nms_.resize(hierarchy_size_[0]);
+  for (int32_t i = 0; i < hierarchy_size_[0]; i++) {
+    std::vector<seeta::FaceInfo> & proposals = proposals_[i];
+    std::vector<seeta::FaceInfo> & reversed = proposals_nms_[i];
+    std::vector<size_t> & level_begin = level_proposal_begin_[i];
+    size_t num_level = level_begin.size();
+    size_t total = proposals.size();
+
+    reversed.clear();
+    for (size_t j = num_level; j > 0; j--) {
+      size_t end = (j < num_level ? level_begin[j] : total);
+      reversed.insert(reversed.end(), proposals.begin() + level_begin[j - 1],
+        proposals.begin() + end);
+    }
+    proposals.swap(reversed);
+
+    // Levels in the new order begin where the old ones end from the back
+    for (size_t j = 0; j < num_level; j++)
+      level_begin[j] = (j + 1 < num_level ? level_begin[j + 1] : total);
+    std::reverse(level_begin.begin(), level_begin.end());
+    for (size_t j = 0; j < num_level; j++)
+      level_begin[j] = total - level_begin[j];
+  }
+}
+
+void FuStDetector::ClearBatchProposals(int32_t num_image) {
+  batch_proposals_.resize(num_image);
+  batch_level_begin_.resize(num_image);
+  for (int32_t n = 0; n < num_image; n++) {
+    batch_proposals_[n].resize(hierarchy_size_[0]);
+    batch_level_begin_[n].resize(hierarchy_size_[0]);
+    for (int32_t i = 0; i < hierarchy_size_[0]; i++) {
+      batch_proposals_[n][i].clear();
+      batch_level_begin_[n][i].clear();
+    }
+  }
+}
+
+void FuStDetector::ScanAtlasLevel(const seeta::ImageData & atlas_img,
+    float scale_factor, const std::vector<seeta::fd::ImageAtlas::Tile> & tiles,
+    bool compute_feat_map) {
   std::shared_ptr<seeta::fd::FeatureMap> & feat_map_1 =
     feat_map_[cls2feat_idx_[model_[0]->type()]];
+  if (compute_feat_map)
+    feat_map_1->Compute(atlas_img.data, atlas_img.width, atlas_img.height);
+  if (use_std_dev_mask_) {
+    static_cast<seeta::fd::LABFeatureMap*>(feat_map_1.get())->GetStdDevMask(
+      wnd_size_, wnd_size_, slide_wnd_step_x_, slide_wnd_step_y_,
+      std_dev_thresh_, &std_dev_mask_);
+  }
+  int32_t num_wnd_x = (atlas_img.width - wnd_size_) / slide_wnd_step_x_ + 1;
 
-  while (img_scaled != nullptr) {
-    feat_map_1->Compute(img_scaled->data, img_scaled->width,
-      img_scaled->height);
-
-    wnd_info.bbox.width = static_cast<int32_t>(wnd_size_ / scale_factor + 0.5);
-    wnd_info.bbox.height = wnd_info.bbox.width;
-
-    int32_t max_x = img_scaled->width - wnd_size_;
-    int32_t max_y = img_scaled->height - wnd_size_;
-    for (int32_t y = 0; y <= max_y; y += slide_wnd_step_y_) {
-      wnd.y = y;
-      for (int32_t x = 0; x <= max_x; x += slide_wnd_step_x_) {
-        wnd.x = x;
-        feat_map_1->SetROI(wnd);
-
-        wnd_info.bbox.x = static_cast<int32_t>(x / scale_factor + 0.5);
-        wnd_info.bbox.y = static_cast<int32_t>(y / scale_factor + 0.5);
-
-        for (int32_t i = 0; i < hierarchy_size_[0]; i++) {
-          if (model_[i]->Classify(&score)) {
-            wnd_info.score = static_cast<double>(score);
-            proposals[i].push_back(wnd_info);
+  int32_t num_tile = static_cast<int32_t>(tiles.size());
+  if (tile_proposals_.size() < tiles.size())
+    tile_proposals_.resize(num_tile);
+  for (int32_t t = 0; t < num_tile; t++) {
+    tile_proposals_[t].resize(hierarchy_size_[0]);
+    for (int32_t i = 0; i < hierarchy_size_[0]; i++)
+      tile_proposals_[t][i].clear();
+  }
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(SEETA_NUM_THREADS) \
+    if (is_first_level_lab_)
+  for (int32_t t = 0; t < num_tile; t++)
+    ScanAtlasTile(tiles[t], scale_factor, num_wnd_x, feat_map_1.get(),
+      &(tile_proposals_[t]));
+
+  for (int32_t t = 0; t < num_tile; t++) {
+    int32_t n = tiles[t].image_idx;
+    for (int32_t i = 0; i < hierarchy_size_[0]; i++) {
+      batch_level_begin_[n][i].push_back(batch_proposals_[n][i].size());
+      batch_proposals_[n][i].insert(batch_proposals_[n][i].end(),
+        tile_proposals_[t][i].begin(), tile_proposals_[t][i].end());
+    }
+  }
+}
+
+void FuStDetector::ScanAtlasTile(const seeta::fd::ImageAtlas::Tile & tile,
+    float scale_factor, int32_t num_wnd_x, seeta::fd::FeatureMap* feat_map,
+    std::vector<std::vector<seeta::FaceInfo> >* proposals) {
+  int32_t num_tile_wnd_x = (tile.rect.width - wnd_size_) / slide_wnd_step_x_ + 1;
+  int32_t num_tile_wnd_y =
+    (tile.rect.height - wnd_size_) / slide_wnd_step_y_ + 1;
+  int32_t wnd_r = tile.rect.y / slide_wnd_step_y_;
+  int32_t wnd_c = tile.rect.x / slide_wnd_step_x_;
+
+  float score;
+  seeta::FaceInfo wnd_info;
+  seeta::Rect wnd;
+  wnd.height = wnd.width = wnd_size_;
+  wnd_info.bbox.width = static_cast<int32_t>(wnd_size_ / scale_factor + 0.5);
+  wnd_info.bbox.height = wnd_info.bbox.width;
+
+  // Boxes are computed from the positions in the tile, as in ScanLevel()
+  for (int32_t r = 0; r < num_tile_wnd_y; r++) {
+    const uint8_t* mask = (use_std_dev_mask_ ?
+      std_dev_mask_.data() + (r + wnd_r) * num_wnd_x + wnd_c : nullptr);
+    wnd.y = tile.rect.y + r * slide_wnd_step_y_;
+    wnd_info.bbox.y =
+      static_cast<int32_t>(r * slide_wnd_step_y_ / scale_factor + 0.5);
+    for (int32_t c = 0; c < num_tile_wnd_x; c++) {
+      if (use_std_dev_mask_ && mask[c] == 0)
+        continue;
+
+      wnd.x = tile.rect.x + c * slide_wnd_step_x_;
+      wnd_info.bbox.x =
+        static_cast<int32_t>(c * slide_wnd_step_x_ / scale_factor + 0.5);
+      for (int32_t i = 0; i < hierarchy_size_[0]; i++) {
+        bool is_face;
+        if (is_first_level_lab_) {
+          const seeta::fd::LABBoostedClassifier* classifier =
+            static_cast<const seeta::fd::LABBoostedClassifier*>(
+            model_[i].get());
+          is_face = classifier->Classify(
+            *static_cast<const seeta::fd::LABFeatureMap*>(feat_map), wnd,
+            &score, !use_std_dev_mask_);
+        } else {
+          feat_map->SetROI(wnd);
+          is_face = model_[i]->Classify(&score);
+        }
+        if (is_face) {
+          wnd_info.score = static_cast<double>(score);
+          (*proposals)[i].push_back(wnd_info);
+        }
+      }
+    }
+  }
+}
+
+void FuStDetector::RefineBatchProposals(int32_t image_idx,
+    const seeta::ImageData & img, std::vector<seeta::FaceInfo>* faces) {
+  proposals_.swap(batch_proposals_[image_idx]);
+  level_proposal_begin_.swap(batch_level_begin_[image_idx]);
+  RefineProposals(img, faces);
+  proposals_.swap(batch_proposals_[image_idx]);
+  level_proposal_begin_.swap(batch_level_begin_[image_idx]);
+}
+
+void FuStDetector::ScanLevel(const seeta::ImageData & img_scaled,
+    float scale_factor, bool compute_feat_map) {
+  seeta::ScaledImage level;
+  level.image = img_scaled;
+  level.stride = img_scaled.width;
+  level.scale_factor = scale_factor;
+  ScanLevel(level, compute_feat_map);
+}
+
+void FuStDetector::ScanLevel(const seeta::ScaledImage & level,
+    bool compute_feat_map) {
+  const seeta::ImageData & img_scaled = level.image;
+  float scale_factor = level.scale_factor;
+  float score;
+  seeta::FaceInfo wnd_info;
+  seeta::Rect wnd;
+  wnd.height = wnd.width = wnd_size_;
+
+  std::vector<std::vector<seeta::FaceInfo> > & proposals = proposals_;
+  std::shared_ptr<seeta::fd::FeatureMap> & feat_map_1 =
+    feat_map_[cls2feat_idx_[model_[0]->type()]];
+  for (int32_t i = 0; i < hierarchy_size_[0]; i++)
+    level_proposal_begin_[i].push_back(proposals[i].size());
+
+  // With motion gating or incremental detection, only the part of the scaled
+  // image covering the windows to evaluate is scanned, whose offset is aligned
+  // to the window steps.
+  seeta::ImageData img = img_scaled;
+  int32_t stride = level.stride;
+  seeta::Rect region;
+  region.x = region.y = 0;
+  LevelCache* cache = nullptr;
+  bool is_cache_valid = false;
+  bool use_wnd_mask = (motion_mask_ != nullptr);
+  int32_t full_num_wnd_x =
+    (img_scaled.width - wnd_size_) / slide_wnd_step_x_ + 1;
+  if (dirty_mask_ != nullptr) {
+    // All windows are evaluated for a scaled image without cached results
+    cache = GetLevelCache(img_scaled, scale_factor, &is_cache_valid);
+    use_wnd_mask = is_cache_valid;
+    new_wnd_idx_.resize(hierarchy_size_[0]);
+    for (int32_t i = 0; i < hierarchy_size_[0]; i++)
+      new_wnd_idx_[i].clear();
+  }
+  if (use_wnd_mask) {
+    if (!ComputeWindowMask(img_scaled, scale_factor, &region)) {
+      if (cache != nullptr)
+        UpdateLevelCache(cache, is_cache_valid);
+      return;
+    }
+    if (region.width != img_scaled.width ||
+        region.height != img_scaled.height) {
+      active_region_data_.resize(region.width * region.height);
+      for (int32_t r = 0; r < region.height; r++) {
+        std::memcpy(active_region_data_.data() + r * region.width,
+          img_scaled.data + (region.y + r) * stride + region.x,
+          region.width * sizeof(uint8_t));
+      }
+      img.data = active_region_data_.data();
+      img.width = region.width;
+      img.height = region.height;
+      stride = region.width;
+    }
+  }
+  int32_t region_r = region.y / slide_wnd_step_y_;
+  int32_t region_c = region.x / slide_wnd_step_x_;
+
+  if (compute_feat_map) {
+    feat_map_1->Compute(img.data, img.width, img.height, stride);
+  }
+
+  wnd_info.bbox.width = static_cast<int32_t>(wnd_size_ / scale_factor + 0.5);
+  wnd_info.bbox.height = wnd_info.bbox.width;
+
+  const seeta::fd::LABFeatureMap* lab_map = nullptr;
+  if (use_std_dev_mask_) {
+    static_cast<seeta::fd::LABFeatureMap*>(feat_map_1.get())->GetStdDevMask(
+      wnd_size_, wnd_size_, slide_wnd_step_x_, slide_wnd_step_y_,
+      std_dev_thresh_, &std_dev_mask_);
+    lab_map = static_cast<const seeta::fd::LABFeatureMap*>(feat_map_1.get());
+  }
+
+  int32_t num_wnd_x = 0;
+  int32_t num_wnd_y = 0;
+  if (img.width >= wnd_size_ && img.height >= wnd_size_) {
+    num_wnd_x = (img.width - wnd_size_) / slide_wnd_step_x_ + 1;
+    num_wnd_y = (img.height - wnd_size_) / slide_wnd_step_y_ + 1;
+  }
+
+  for (int32_t r = 0; r < num_wnd_y; r++) {
+    const uint8_t* std_dev_mask = (use_std_dev_mask_ ?
+      std_dev_mask_.data() + r * num_wnd_x : nullptr);
+    const uint8_t* wnd_mask = (use_wnd_mask ?
+      wnd_mask_.data() + (r + region_r) * full_num_wnd_x + region_c :
+      nullptr);
+    wnd.y = r * slide_wnd_step_y_;
+    wnd_info.bbox.y =
+      static_cast<int32_t>((wnd.y + region.y) / scale_factor + 0.5);
+    for (int32_t c = 0; c < num_wnd_x; c++) {
+      if (use_wnd_mask && wnd_mask[c] == 0)
+        continue;
+      if (use_std_dev_mask_ && std_dev_mask[c] == 0)
+        continue;
+
+      wnd.x = c * slide_wnd_step_x_;
+      wnd_info.bbox.x =
+        static_cast<int32_t>((wnd.x + region.x) / scale_factor + 0.5);
+
+      feat_map_1->SetROI(wnd);
+
+      for (int32_t i = 0; i < hierarchy_size_[0]; i++) {
+        bool is_face;
+        if (use_std_dev_mask_) {
+          // The window has passed the standard deviation test in the mask
+          is_face = static_cast<const seeta::fd::LABBoostedClassifier*>(
+            model_[i].get())->Classify(*lab_map, wnd, &score, false);
+        } else {
+          is_face = model_[i]->Classify(&score);
+        }
+        if (is_face) {
+          wnd_info.score = static_cast<double>(score);
+          proposals[i].push_back(wnd_info);
+          if (cache != nullptr) {
+            new_wnd_idx_[i].push_back(
+              (r + region_r) * full_num_wnd_x + c + region_c);
           }
         }
       }
     }
+  }
+
+  if (cache != nullptr)
+    UpdateLevelCache(cache, is_cache_valid);
+}
+
+FuStDetector::LevelCache* FuStDetector::GetLevelCache(
+    const seeta::ImageData & img_scaled, float scale_factor, bool* is_valid) {
+  for (size_t i = 0; i < level_caches_.size(); i++) {
+    LevelCache & cache = level_caches_[i];
+    if (cache.width == img_scaled.width && cache.height == img_scaled.height &&
+        cache.scale_factor == scale_factor &&
+        cache.src_width == dirty_mask_->width() &&
+        cache.src_height == dirty_mask_->height() &&
+        cache.wnd_size == wnd_size_ && cache.step_x == slide_wnd_step_x_ &&
+        cache.step_y == slide_wnd_step_y_) {
+      *is_valid = (cache.frame_id == cache_frame_id_ - 1);
+      cache.frame_id = cache_frame_id_;
+      return &cache;
+    }
+  }
+  if (level_caches_.size() >= kMaxNumLevelCache)
+    level_caches_.clear();
+
+  level_caches_.push_back(LevelCache());
+  LevelCache & cache = level_caches_.back();
+  cache.width = img_scaled.width;
+  cache.height = img_scaled.height;
+  cache.scale_factor = scale_factor;
+  cache.src_width = dirty_mask_->width();
+  cache.src_height = dirty_mask_->height();
+  cache.wnd_size = wnd_size_;
+  cache.step_x = slide_wnd_step_x_;
+  cache.step_y = slide_wnd_step_y_;
+  cache.frame_id = cache_frame_id_;
+  cache.proposals.resize(hierarchy_size_[0]);
+  *is_valid = false;
+  return &cache;
+}
+
+bool FuStDetector::ComputeWindowMask(const seeta::ImageData & img_scaled,
+    float scale_factor, seeta::Rect* region) {
+  int32_t num_wnd_x = (img_scaled.width - wnd_size_) / slide_wnd_step_x_ + 1;
+  int32_t num_wnd_y = (img_scaled.height - wnd_size_) / slide_wnd_step_y_ + 1;
+  if (num_wnd_x <= 0 || num_wnd_y <= 0) {
+    wnd_mask_.clear();
+    return false;
+  }
+  wnd_mask_.assign(num_wnd_x * num_wnd_y, 0);
+
+  seeta::Rect bbox;
+  bbox.width = static_cast<int32_t>(wnd_size_ / scale_factor + 0.5);
+  bbox.height = bbox.width;
+
+  // Source pixels of a scaled pixel are found as in ResizeImage()
+  int32_t src_width = 0;
+  int32_t src_height = 0;
+  double lf_x_scl = 0.0;
+  double lf_y_scl = 0.0;
+  if (dirty_mask_ != nullptr) {
+    src_width = dirty_mask_->width();
+    src_height = dirty_mask_->height();
+    lf_x_scl = static_cast<double>(src_width) / img_scaled.width;
+    lf_y_scl = static_cast<double>(src_height) / img_scaled.height;
+  }
+
+  int32_t min_x = img_scaled.width;
+  int32_t min_y = img_scaled.height;
+  int32_t max_x = -1;
+  int32_t max_y = -1;
+  for (int32_t r = 0; r < num_wnd_y; r++) {
+    int32_t y = r * slide_wnd_step_y_;
+    if (dirty_mask_ != nullptr) {
+      bbox.y = std::min(static_cast<int32_t>(lf_y_scl * y), src_height - 2);
+      bbox.height = std::min(static_cast<int32_t>(
+        lf_y_scl * (y + wnd_size_ - 1)), src_height - 2) + 2 - bbox.y;
+    } else {
+      bbox.y = static_cast<int32_t>(y / scale_factor + 0.5);
+    }
+    uint8_t* wnd_mask = wnd_mask_.data() + r * num_wnd_x;
+    for (int32_t c = 0; c < num_wnd_x; c++) {
+      int32_t x = c * slide_wnd_step_x_;
+      bool is_active;
+      if (dirty_mask_ != nullptr) {
+        bbox.x = std::min(static_cast<int32_t>(lf_x_scl * x), src_width - 2);
+        bbox.width = std::min(static_cast<int32_t>(
+          lf_x_scl * (x + wnd_size_ - 1)), src_width - 2) + 2 - bbox.x;
+        is_active = dirty_mask_->IsActive(bbox);
+      } else {
+        bbox.x = static_cast<int32_t>(x / scale_factor + 0.5);
+        is_active = motion_mask_->IsActive(bbox);
+      }
+      if (is_active) {
+        wnd_mask[c] = 1;
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+      }
+    }
+  }
+  if (max_x < 0)
+    return false;
 
-    img_scaled = img_pyramid->GetNextScaleImage(&scale_factor);
+  region->x = min_x;
+  region->y = min_y;
+  region->width = max_x - min_x + wnd_size_;
+  region->height = max_y - min_y + wnd_size_;
+  return true;
+}
+
+void FuStDetector::UpdateLevelCache(LevelCache* cache, bool is_valid) {
+  for (int32_t i = 0; i < hierarchy_size_[0]; i++) {
+    std::vector<seeta::FaceInfo> & proposals = proposals_[i];
+    size_t begin = level_proposal_begin_[i].back();
+    const std::vector<int32_t> & new_wnd_idx = new_wnd_idx_[i];
+
+    wnd_proposal_buf_.clear();
+    for (size_t j = begin; j < proposals.size(); j++) {
+      WindowProposal proposal;
+      proposal.info = proposals[j];
+      proposal.wnd_idx = new_wnd_idx[j - begin];
+      wnd_proposal_buf_.push_back(proposal);
+    }
+    if (is_valid) {
+      const std::vector<WindowProposal> & cached = cache->proposals[i];
+      for (size_t j = 0; j < cached.size(); j++) {
+        if (wnd_mask_.empty() || wnd_mask_[cached[j].wnd_idx] == 0)
+          wnd_proposal_buf_.push_back(cached[j]);
+      }
+    }
+
+    // Window indices follow the raster order, on which NMS depends for ties
+    std::sort(wnd_proposal_buf_.begin(), wnd_proposal_buf_.end(),
+      [](const WindowProposal & a, const WindowProposal & b) {
+        return a.wnd_idx < b.wnd_idx;
+      });
+    proposals.resize(begin);
+    for (size_t j = 0; j < wnd_proposal_buf_.size(); j++)
+      proposals.push_back(wnd_proposal_buf_[j].info);
+    cache->proposals[i].swap(wnd_proposal_buf_);
   }
+}
 
-  std::vector<std::vector<seeta::FaceInfo> > proposals_nms(hierarchy_size_[0]);
+bool FuStDetector::RefineProposals(const seeta::ImageData & img,
+    std::vector<seeta::FaceInfo>* faces,
+    const std::chrono::steady_clock::time_point* deadline) {
+  bool is_complete = true;
+  std::vector<std::vector<seeta::FaceInfo> > & proposals = proposals_;
+  std::vector<std::vector<seeta::FaceInfo> > & proposals_nms = proposals_nms_;
+  if (profile_ != nullptr) {
+    // Models may be loaded after the profile is set
+    if (profile_->stages.size() < model_.size())
+      profile_->stages.resize(model_.size());
+    // Views are counted at their last stages
+    profile_->num_detection++;
+    if (scan_start_ != std::chrono::steady_clock::time_point()) {
+      profile_->scan_time_ms += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - scan_start_).count();
+      scan_start_ = std::chrono::steady_clock::time_point();
+    }
+    int32_t view_model_idx = -1;
+    for (int32_t i = 0; i < hierarchy_size_[0]; i++) {
+      view_model_idx += num_stage_[i];
+      profile_->stages[view_model_idx].num_output += proposals[i].size();
+    }
+  }
+  proposals_nms.resize(hierarchy_size_[0]);
+  view_nms_mask_buf_.resize(hierarchy_size_[0]);
+#pragma omp parallel for num_threads(SEETA_NUM_THREADS) \
+    if (hierarchy_size_[0] > 1)
   for (int32_t i = 0; i < hierarchy_size_[0]; i++) {
     seeta::fd::NonMaximumSuppression(&(proposals[i]),
-      &(proposals_nms[i]), 0.8f);
+      &(proposals_nms[i]), 0.8f, &(view_nms_mask_buf_[i]));
     proposals[i].clear();
   }
 
+  if (max_refine_stage_ == 0) {
+    // Views are merged as the second hierarchy would take them, and the final
+    // NMS is applied right away.
+    std::vector<seeta::FaceInfo> & merged = proposals[0];
+    for (int32_t i = 0; i < hierarchy_size_[0]; i++) {
+      merged.insert(merged.end(), proposals_nms[i].begin(),
+        proposals_nms[i].end());
+    }
+    seeta::fd::NonMaximumSuppression(&merged, faces, 0.3f, &nms_mask_buf_);
+    merged.clear();
+    return is_complete;
+  }
+
   // Following classifiers
 
-  seeta::ImageData img = img_pyramid->image1x();
-  seeta::Rect roi;
-  std::vector<float> mlp_predicts(4);  // @todo no hard-coded number!
-  roi.x = roi.y = 0;
-  roi.width = roi.height = wnd_size_;
+  refine_workers_.resize(kNumThread);
+  for (size_t i = 0; i < refine_workers_.size(); i++) {
+    RefineWorker & worker = refine_workers_[i];
+    if (worker.feat_map.get() == nullptr)
+      worker.feat_map.reset(new seeta::fd::SURFFeatureMap());
+    worker.wnd_data.resize(wnd_size_ * wnd_size_);
+    worker.mlp_predicts.resize(4);  // @todo no hard-coded number!
+  }
 
   int32_t cls_idx = hierarchy_size_[0];
   int32_t model_idx = hierarchy_size_[0];
-  std::vector<int32_t> buf_idx;
+  std::vector<int32_t> & buf_idx = buf_idx_;
 
+  // If stages are cut off, outputs of those run weight the scores of the first
+  // hierarchy instead of replacing them, since sums of the outputs of an early
+  // stage over merged windows rank faces worse than the LAB scores do.
+  int32_t num_refine_stage = 0;
+  for (int32_t i = 1, idx = hierarchy_size_[0]; i < num_hierarchy_; i++) {
+    int32_t hierarchy_num_stage = 0;
+    for (int32_t j = 0; j < hierarchy_size_[i]; j++, idx++)
+      hierarchy_num_stage = std::max(hierarchy_num_stage, num_stage_[idx]);
+    num_refine_stage += hierarchy_num_stage;
+  }
+  bool weight_score =
+    (max_refine_stage_ > 0 && max_refine_stage_ < num_refine_stage);
+
+  int32_t num_stage_before = 0;
   for (int32_t i = 1; i < num_hierarchy_; i++) {
+    // The hierarchy is the last one if stages after it are cut off
+    int32_t hierarchy_num_stage = 0;
+    for (int32_t j = 0; j < hierarchy_size_[i]; j++) {
+      hierarchy_num_stage =
+        std::max(hierarchy_num_stage, num_stage_[cls_idx + j]);
+    }
+    bool is_last_hierarchy = (i == num_hierarchy_ - 1 ||
+      (max_refine_stage_ > 0 &&
+      num_stage_before + hierarchy_num_stage >= max_refine_stage_));
+
     buf_idx.resize(hierarchy_size_[i]);
     for (int32_t j = 0; j < hierarchy_size_[i]; j++) {
       int32_t num_wnd_src = static_cast<int32_t>(wnd_src_id_[cls_idx].size());
@@ -195,64 +934,162 @@ std::vector<seeta::FaceInfo> FuStDetector::Detect(
           proposals_nms[wnd_src[k]].begin(), proposals_nms[wnd_src[k]].end());
       }
 
-      std::shared_ptr<seeta::fd::FeatureMap> & feat_map =
-        feat_map_[cls2feat_idx_[model_[model_idx]->type()]];
-      for (int32_t k = 0; k < num_stage_[cls_idx]; k++) {
+      int32_t num_stage = num_stage_[cls_idx];
+      if (max_refine_stage_ > 0)
+        num_stage = std::min(num_stage, max_refine_stage_ - num_stage_before);
+      for (int32_t k = 0; k < num_stage; k++) {
         int32_t num_wnd = static_cast<int32_t>(proposals[buf_idx[j]].size());
         std::vector<seeta::FaceInfo> & bboxes = proposals[buf_idx[j]];
-        int32_t bbox_idx = 0;
+        std::chrono::steady_clock::time_point stage_start;
+        if (profile_ != nullptr)
+          stage_start = std::chrono::steady_clock::now();
 
-        for (int32_t m = 0; m < num_wnd; m++) {
-          if (bboxes[m].bbox.x + bboxes[m].bbox.width <= 0 ||
-              bboxes[m].bbox.y + bboxes[m].bbox.height <= 0)
-            continue;
-          GetWindowData(img, bboxes[m].bbox);
-          feat_map->Compute(wnd_data_.data(), wnd_size_, wnd_size_);
-          feat_map->SetROI(roi);
-
-          if (model_[model_idx]->Classify(&score, mlp_predicts.data())) {
-            float x = static_cast<float>(bboxes[m].bbox.x);
-            float y = static_cast<float>(bboxes[m].bbox.y);
-            float w = static_cast<float>(bboxes[m].bbox.width);
-            float h = static_cast<float>(bboxes[m].bbox.height);
-
-            bboxes[bbox_idx].bbox.width =
-              static_cast<int32_t>((mlp_predicts[3] * 2 - 1) * w + w + 0.5);
-            bboxes[bbox_idx].bbox.height = bboxes[bbox_idx].bbox.width;
-            bboxes[bbox_idx].bbox.x =
-              static_cast<int32_t>((mlp_predicts[1] * 2 - 1) * w + x +
-              (w - bboxes[bbox_idx].bbox.width) * 0.5 + 0.5);
-            bboxes[bbox_idx].bbox.y =
-              static_cast<int32_t>((mlp_predicts[2] * 2 - 1) * h + y +
-              (h - bboxes[bbox_idx].bbox.height) * 0.5 + 0.5);
-            bboxes[bbox_idx].score = score;
-            bbox_idx++;
+        // Under a deadline, windows entering refinement are taken in order of
+        // score until it passes. Those accepted are kept in the original order
+        // so that a complete run gives the same results as one without.
+        bool check_deadline = (deadline != nullptr && i == 1 && k == 0);
+        std::vector<int32_t> & wnd_order = wnd_order_;
+        wnd_order.resize(num_wnd);
+        for (int32_t m = 0; m < num_wnd; m++)
+          wnd_order[m] = m;
+        if (check_deadline) {
+          std::sort(wnd_order.begin(), wnd_order.end(),
+            [&bboxes](int32_t a, int32_t b) {
+              return bboxes[a].score > bboxes[b].score ||
+                (bboxes[a].score == bboxes[b].score && a < b);
+            });
+        }
+        wnd_accepted_.assign(num_wnd, 0);
+
+        if (check_deadline) {
+          for (int32_t n = 0; n < num_wnd; n++) {
+            if (std::chrono::steady_clock::now() >= *deadline) {
+              is_complete = false;
+              break;
+            }
+
+            int32_t m = wnd_order[n];
+            if (bboxes[m].bbox.x + bboxes[m].bbox.width <= 0 ||
+                bboxes[m].bbox.y + bboxes[m].bbox.height <= 0)
+              continue;
+            if (RefineWindow(img, model_idx, &(bboxes[m]), &refine_workers_[0],
+                weight_score))
+              wnd_accepted_[m] = 1;
+          }
+        } else {
+          // Proposals are independent of each other, and written in place
+          bool is_parallel =
+            (model_[model_idx]->type() == seeta::fd::ClassifierType::SURF_MLP);
+#pragma omp parallel for schedule(dynamic) num_threads(SEETA_NUM_THREADS) if (is_parallel)
+          for (int32_t m = 0; m < num_wnd; m++) {
+            if (bboxes[m].bbox.x + bboxes[m].bbox.width <= 0 ||
+                bboxes[m].bbox.y + bboxes[m].bbox.height <= 0)
+              continue;
+            RefineWorker* worker = &refine_workers_[GetThreadId()];
+            if (RefineWindow(img, model_idx, &(bboxes[m]), worker,
+                weight_score))
+              wnd_accepted_[m] = 1;
           }
         }
+
+        int32_t bbox_idx = 0;
+        for (int32_t m = 0; m < num_wnd; m++) {
+          if (wnd_accepted_[m] != 0)
+            bboxes[bbox_idx++] = bboxes[m];
+        }
         proposals[buf_idx[j]].resize(bbox_idx);
+        if (profile_ != nullptr) {
+          StageStat & stat = profile_->stages[model_idx];
+          stat.num_input += num_wnd;
+          stat.num_output += bbox_idx;
+          stat.time_ms += std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - stage_start).count();
+        }
 
-        if (k < num_stage_[cls_idx] - 1) {
+        if (k < num_stage - 1) {
           seeta::fd::NonMaximumSuppression(&(proposals[buf_idx[j]]),
-            &(proposals_nms[buf_idx[j]]), 0.8f);
+            &(proposals_nms[buf_idx[j]]), 0.8f, &nms_mask_buf_);
           proposals[buf_idx[j]] = proposals_nms[buf_idx[j]];
         } else {
-          if (i == num_hierarchy_ - 1) {
+          if (is_last_hierarchy) {
             seeta::fd::NonMaximumSuppression(&(proposals[buf_idx[j]]),
-              &(proposals_nms[buf_idx[j]]), 0.3f);
+              &(proposals_nms[buf_idx[j]]), 0.3f, &nms_mask_buf_);
             proposals[buf_idx[j]] = proposals_nms[buf_idx[j]];
           }
         }
         model_idx++;
       }
 
+      // Models of the stages cut off
+      model_idx += num_stage_[cls_idx] - num_stage;
       cls_idx++;
     }
 
     for (int32_t j = 0; j < hierarchy_size_[i]; j++)
       proposals_nms[j] = proposals[buf_idx[j]];
+    if (is_last_hierarchy)
+      break;
+    num_stage_before += hierarchy_num_stage;
+  }
+
+  *faces = proposals_nms[0];
+  return is_complete;
+}
+
+void FuStDetector::SetProfile(Profile* profile) {
+  profile_ = profile;
+  scan_start_ = std::chrono::steady_clock::time_point();
+  if (profile_ != nullptr)
+    profile_->stages.resize(model_.size());
+}
+
+std::shared_ptr<seeta::fd::FeatureMap> FuStDetector::feature_map(
+    seeta::fd::ClassifierType type) const {
+  std::map<seeta::fd::ClassifierType, int32_t>::const_iterator iter =
+    cls2feat_idx_.find(type);
+  if (iter == cls2feat_idx_.end())
+    return std::shared_ptr<seeta::fd::FeatureMap>();
+  return feat_map_[iter->second];
+}
+
+void FuStDetector::SetFeatureMap(seeta::fd::ClassifierType type,
+    const std::shared_ptr<seeta::fd::FeatureMap> & feat_map) {
+  std::map<seeta::fd::ClassifierType, int32_t>::const_iterator iter =
+    cls2feat_idx_.find(type);
+  if (iter == cls2feat_idx_.end() || feat_map.get() == nullptr)
+    return;
+
+  feat_map_[iter->second] = feat_map;
+  for (size_t i = 0; i < model_.size(); i++) {
+    if (model_[i]->type() == type)
+      model_[i]->SetFeatureMap(feat_map.get());
+  }
+}
+
+void FuStDetector::CheckStdDevMask() {
+  use_std_dev_mask_ = (!hierarchy_size_.empty() && hierarchy_size_[0] > 0 &&
+    seeta::fd::LABFeatureMap::IsStdDevMaskExact(wnd_size_, wnd_size_));
+  for (int32_t i = 0; use_std_dev_mask_ && i < hierarchy_size_[0]; i++) {
+    if (model_[i]->type() !=
+        seeta::fd::ClassifierType::LAB_Boosted_Classifier) {
+      use_std_dev_mask_ = false;
+    } else {
+      seeta::fd::LABBoostedClassifier* classifier =
+        static_cast<seeta::fd::LABBoostedClassifier*>(model_[i].get());
+      if (i == 0)
+        std_dev_thresh_ = classifier->std_dev_thresh();
+      use_std_dev_mask_ = classifier->use_std_dev() &&
+        classifier->std_dev_thresh() == std_dev_thresh_;
+    }
   }
+}
 
-  return proposals_nms[0];
+void FuStDetector::CheckFirstLevelLAB() {
+  is_first_level_lab_ = (hierarchy_size_[0] > 0);
+  for (int32_t i = 0; is_first_level_lab_ && i < hierarchy_size_[0]; i++) {
+    is_first_level_lab_ = (model_[i]->type() ==
+      seeta::fd::ClassifierType::LAB_Boosted_Classifier);
+  }
 }
 
 std::shared_ptr<seeta::fd::ModelReader>
@@ -303,8 +1140,55 @@ FuStDetector::CreateFeatureMap(seeta::fd::ClassifierType type) {
   return feat_map;
 }
 
+bool FuStDetector::RefineWindow(const seeta::ImageData & img,
+    int32_t model_idx, seeta::FaceInfo* wnd_info, RefineWorker* worker,
+    bool weight_score) {
+  float score;
+  seeta::Rect roi;
+  roi.x = roi.y = 0;
+  roi.width = roi.height = wnd_size_;
+  float* mlp_predicts = worker->mlp_predicts.data();
+
+  GetWindowData(img, wnd_info->bbox, worker);
+  bool is_pos;
+  const std::shared_ptr<seeta::fd::Classifier> & classifier =
+    model_[model_idx];
+  if (classifier->type() == seeta::fd::ClassifierType::SURF_MLP) {
+    worker->feat_map->Compute(worker->wnd_data.data(), wnd_size_, wnd_size_);
+    worker->feat_map->SetROI(roi);
+    is_pos = static_cast<const seeta::fd::SURFMLP*>(classifier.get())->Classify(
+      worker->feat_map.get(), &(worker->mlp_workspace), &score, mlp_predicts);
+  } else {
+    std::shared_ptr<seeta::fd::FeatureMap> & feat_map =
+      feat_map_[cls2feat_idx_[classifier->type()]];
+    feat_map->Compute(worker->wnd_data.data(), wnd_size_, wnd_size_);
+    feat_map->SetROI(roi);
+    is_pos = classifier->Classify(&score, mlp_predicts);
+  }
+  if (!is_pos)
+    return false;
+
+  seeta::Rect & bbox = wnd_info->bbox;
+  float x = static_cast<float>(bbox.x);
+  float y = static_cast<float>(bbox.y);
+  float w = static_cast<float>(bbox.width);
+  float h = static_cast<float>(bbox.height);
+
+  bbox.width = static_cast<int32_t>((mlp_predicts[3] * 2 - 1) * w + w + 0.5);
+  bbox.height = bbox.width;
+  bbox.x = static_cast<int32_t>((mlp_predicts[1] * 2 - 1) * w + x +
+    (w - bbox.width) * 0.5 + 0.5);
+  bbox.y = static_cast<int32_t>((mlp_predicts[2] * 2 - 1) * h + y +
+    (h - bbox.height) * 0.5 + 0.5);
+  if (weight_score)
+    wnd_info->score *= score;
+  else
+    wnd_info->score = score;
+  return true;
+}
+
 void FuStDetector::GetWindowData(const seeta::ImageData & img,
-    const seeta::Rect & wnd) {
+    const seeta::Rect & wnd, RefineWorker* worker) {
   int32_t pad_left;
   int32_t pad_right;
   int32_t pad_top;
@@ -325,9 +1209,10 @@ void FuStDetector::GetWindowData(const seeta::ImageData & img,
     roi.y = 0;
   }
 
-  wnd_data_buf_.resize(roi.width * roi.height);
+  std::vector<uint8_t> & wnd_data_buf = worker->wnd_data_buf;
+  wnd_data_buf.resize(roi.width * roi.height);
   const uint8_t* src = img.data + roi.y * img.width + roi.x;
-  uint8_t* dest = wnd_data_buf_.data();
+  uint8_t* dest = wnd_data_buf.data();
   int32_t len = sizeof(uint8_t) * roi.width;
   int32_t len2 = sizeof(uint8_t) * (roi.width - pad_left - pad_right);
 
@@ -373,8 +1258,8 @@ void FuStDetector::GetWindowData(const seeta::ImageData & img,
 
   seeta::ImageData src_img(roi.width, roi.height);
   seeta::ImageData dest_img(wnd_size_, wnd_size_);
-  src_img.data = wnd_data_buf_.data();
-  dest_img.data = wnd_data_.data();
+  src_img.data = wnd_data_buf.data();
+  dest_img.data = worker->wnd_data.data();
   seeta::fd::ResizeImage(src_img, &dest_img);
 }
 
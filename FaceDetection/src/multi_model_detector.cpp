@@ -0,0 +1,275 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include "multi_model_detector.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "util/nms.h"
+
+namespace seeta {
+namespace fd {
+
+bool MultiModelDetector::LoadModel(const std::string & model_path) {
+  std::shared_ptr<seeta::fd::FuStDetector> detector(
+    new seeta::fd::FuStDetector());
+  if (!detector->LoadModel(model_path))
+    return false;
+
+  detector->SetWindowSize(wnd_size_);
+  detector->SetSlideWindowStep(slide_wnd_step_x_, slide_wnd_step_y_);
+  detector->SetMotionMask(motion_mask_);
+  detector->SetDirtyMask(dirty_mask_);
+  detector->SetMaxRefineStage(max_refine_stage_);
+
+  const seeta::fd::ClassifierType types[] = {
+    seeta::fd::ClassifierType::LAB_Boosted_Classifier,
+    seeta::fd::ClassifierType::SURF_MLP
+  };
+  for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+    for (size_t j = 0; j < detectors_.size(); j++) {
+      std::shared_ptr<seeta::fd::FeatureMap> feat_map =
+        detectors_[j]->feature_map(types[i]);
+      if (feat_map.get() != nullptr) {
+        detector->SetFeatureMap(types[i], feat_map);
+        break;
+      }
+    }
+  }
+
+  // The first feature map has been computed if it is shared with a detector
+  // loaded earlier, since all detectors scan the same scaled image in turn.
+  bool compute_feat_map = true;
+  for (size_t j = 0; compute_feat_map && j < detectors_.size(); j++) {
+    compute_feat_map = (detectors_[j]->first_classifier_type() !=
+      detector->first_classifier_type());
+  }
+
+  detectors_.push_back(detector);
+  compute_feat_map_.push_back(compute_feat_map);
+  return true;
+}
+
+std::vector<seeta::FaceInfo> MultiModelDetector::Detect(
+    seeta::fd::ImagePyramid* img_pyramid) {
+  std::vector<seeta::FaceInfo> faces;
+  Detect(img_pyramid, &faces);
+  return faces;
+}
+
+void MultiModelDetector::Detect(seeta::fd::ImagePyramid* img_pyramid,
+    std::vector<seeta::FaceInfo>* faces) {
+  faces->clear();
+  if (detectors_.empty())
+    return;
+  if (detectors_.size() == 1) {
+    detectors_[0]->Detect(img_pyramid, faces);
+    return;
+  }
+
+  float scale_factor = 0.0;
+  const seeta::ImageData* img_scaled =
+    img_pyramid->GetNextScaleImage(&scale_factor);
+
+  for (size_t i = 0; i < detectors_.size(); i++)
+    detectors_[i]->ClearProposals();
+  while (img_scaled != nullptr) {
+    // The evaluated region of a level depends on the cache of each model
+    for (size_t i = 0; i < detectors_.size(); i++) {
+      detectors_[i]->ScanLevel(*img_scaled, scale_factor,
+        compute_feat_map_[i] || dirty_mask_ != nullptr);
+    }
+    img_scaled = img_pyramid->GetNextScaleImage(&scale_factor);
+  }
+
+  seeta::ImageData img = img_pyramid->image1x();
+  for (size_t i = 0; i < detectors_.size(); i++) {
+    detectors_[i]->RefineProposals(img, &faces_buf_);
+    faces->insert(faces->end(), faces_buf_.begin(), faces_buf_.end());
+  }
+  MergeFaces(faces);
+}
+
+void MultiModelDetector::Detect(const seeta::ImageData & img,
+    const std::vector<seeta::ScaledImage> & levels,
+    std::vector<seeta::FaceInfo>* faces) {
+  faces->clear();
+  if (detectors_.empty())
+    return;
+  if (detectors_.size() == 1) {
+    detectors_[0]->Detect(img, levels, faces);
+    return;
+  }
+
+  for (size_t i = 0; i < detectors_.size(); i++)
+    detectors_[i]->ClearProposals();
+  for (size_t j = 0; j < levels.size(); j++) {
+    for (size_t i = 0; i < detectors_.size(); i++)
+      detectors_[i]->ScanLevel(levels[j], compute_feat_map_[i]);
+  }
+
+  for (size_t i = 0; i < detectors_.size(); i++) {
+    detectors_[i]->RefineProposals(img, &faces_buf_);
+    faces->insert(faces->end(), faces_buf_.begin(), faces_buf_.end());
+  }
+  MergeFaces(faces);
+}
+
+void MultiModelDetector::Detect(const std::vector<seeta::ImageData> & images,
+    seeta::fd::ImageAtlas* atlas,
+    std::vector<std::vector<seeta::FaceInfo> >* faces) {
+  int32_t num_image = static_cast<int32_t>(images.size());
+  faces->resize(num_image);
+  for (int32_t n = 0; n < num_image; n++)
+    (*faces)[n].clear();
+  if (detectors_.empty())
+    return;
+  if (detectors_.size() == 1) {
+    detectors_[0]->Detect(images, atlas, faces);
+    return;
+  }
+
+  atlas->SetWindow(wnd_size_, slide_wnd_step_x_, slide_wnd_step_y_);
+  for (size_t i = 0; i < detectors_.size(); i++)
+    detectors_[i]->ClearBatchProposals(num_image);
+  float scale_factor = 0.0f;
+  const seeta::ImageData* atlas_img = atlas->GetNextLevel(&scale_factor);
+  while (atlas_img != nullptr) {
+    for (size_t i = 0; i < detectors_.size(); i++) {
+      detectors_[i]->ScanAtlasLevel(*atlas_img, scale_factor, atlas->tiles(),
+        compute_feat_map_[i]);
+    }
+    atlas_img = atlas->GetNextLevel(&scale_factor);
+  }
+
+  for (int32_t n = 0; n < num_image; n++) {
+    for (size_t i = 0; i < detectors_.size(); i++) {
+      detectors_[i]->RefineBatchProposals(n, images[n], &faces_buf_);
+      (*faces)[n].insert((*faces)[n].end(), faces_buf_.begin(),
+        faces_buf_.end());
+    }
+    MergeFaces(&((*faces)[n]));
+  }
+}
+
+bool MultiModelDetector::Detect(seeta::fd::ImagePyramid* img_pyramid,
+    std::vector<seeta::FaceInfo>* faces,
+    const std::chrono::steady_clock::time_point & deadline) {
+  faces->clear();
+  if (detectors_.empty())
+    return true;
+  if (detectors_.size() == 1)
+    return detectors_[0]->Detect(img_pyramid, faces, deadline);
+
+  // Same order of work as FuStDetector, with all models on each scale
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point scan_deadline = start +
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    (deadline - start) * seeta::fd::FuStDetector::kScanTimeRatio);
+  bool is_complete = true;
+
+  for (size_t i = 0; i < detectors_.size(); i++)
+    detectors_[i]->ClearProposals();
+  for (int32_t level = img_pyramid->num_level() - 1; level >= 0; level--) {
+    if (std::chrono::steady_clock::now() >= scan_deadline) {
+      is_complete = false;
+      break;
+    }
+    if (!img_pyramid->is_level_enabled(level))
+      continue;
+    float scale_factor = 0.0f;
+    const seeta::ImageData* img_scaled =
+      img_pyramid->GetScaleImage(level, &scale_factor);
+    for (size_t i = 0; i < detectors_.size(); i++) {
+      detectors_[i]->ScanLevel(*img_scaled, scale_factor,
+        compute_feat_map_[i]);
+    }
+  }
+  if (is_complete) {
+    for (size_t i = 0; i < detectors_.size(); i++)
+      detectors_[i]->ReverseLevelOrder();
+  }
+
+  seeta::ImageData img = img_pyramid->image1x();
+  for (size_t i = 0; i < detectors_.size(); i++) {
+    if (!detectors_[i]->RefineProposals(img, &faces_buf_, &deadline))
+      is_complete = false;
+    faces->insert(faces->end(), faces_buf_.begin(), faces_buf_.end());
+  }
+  MergeFaces(faces);
+  return is_complete;
+}
+
+void MultiModelDetector::SetWindowSize(int32_t size) {
+  if (size >= 20) {
+    wnd_size_ = size;
+    for (size_t i = 0; i < detectors_.size(); i++)
+      detectors_[i]->SetWindowSize(size);
+  }
+}
+
+void MultiModelDetector::SetSlideWindowStep(int32_t step_x, int32_t step_y) {
+  if (step_x > 0)
+    slide_wnd_step_x_ = step_x;
+  if (step_y > 0)
+    slide_wnd_step_y_ = step_y;
+  for (size_t i = 0; i < detectors_.size(); i++)
+    detectors_[i]->SetSlideWindowStep(step_x, step_y);
+}
+
+void MultiModelDetector::SetMaxRefineStage(int32_t num_stage) {
+  max_refine_stage_ = num_stage;
+  for (size_t i = 0; i < detectors_.size(); i++)
+    detectors_[i]->SetMaxRefineStage(num_stage);
+}
+
+void MultiModelDetector::SetMotionMask(const seeta::fd::CellMask* mask) {
+  motion_mask_ = mask;
+  for (size_t i = 0; i < detectors_.size(); i++)
+    detectors_[i]->SetMotionMask(mask);
+}
+
+void MultiModelDetector::SetDirtyMask(const seeta::fd::CellMask* mask) {
+  dirty_mask_ = mask;
+  for (size_t i = 0; i < detectors_.size(); i++)
+    detectors_[i]->SetDirtyMask(mask);
+}
+
+void MultiModelDetector::MergeFaces(std::vector<seeta::FaceInfo>* faces) {
+  // Scores of different models are not accumulated
+  seeta::fd::MergeOverlappedFaces(faces, 0.3f, &merged_buf_);
+}
+
+}  // namespace fd
+}  // namespace seeta
@@ -0,0 +1,751 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is an example of how to use SeetaFace engine for face detection, the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "classifier/mlp.h"
+#include "face_detection.h"
+#include "feat/lab_feature_map.h"
+#include "feat/surf_feature_map.h"
+#include "fust.h"
+#include "util/cell_mask.h"
+#include "util/image_pyramid.h"
+#include "util/nms.h"
+
+#include "reference_kernels.h"
+
+using namespace std;
+
+namespace {
+
+const uint32_t kSeed = 20160921;
+const int32_t kWndSize = 40;
+const int32_t kMinFaceSize = 40;
+const float kScaleStep = 0.8f;
+
+/** @struct TestImage
+ *  @brief A gray-scale image owning its pixels.
+ */
+typedef struct TestImage {
+  string name;
+  int32_t width;
+  int32_t height;
+  vector<uint8_t> data;
+
+  seeta::ImageData image() const {
+    seeta::ImageData img(width, height, 1);
+    img.data = const_cast<uint8_t*>(data.data());
+    return img;
+  }
+} TestImage;
+
+/** @struct Result
+ *  @brief Agreement of an optimized path with the reference one.
+ */
+typedef struct Result {
+  string name;
+  int64_t num_case;
+  double max_deviation;
+  int64_t num_mismatch;
+  double tolerance;
+} Result;
+
+/**< Results are added while others are being updated, so kept in place */
+deque<Result> results;
+mt19937 rng(kSeed);
+
+int32_t RandomInt(int32_t min_val, int32_t max_val) {
+  return uniform_int_distribution<int32_t>(min_val, max_val)(rng);
+}
+
+float RandomFloat(float min_val, float max_val) {
+  return uniform_real_distribution<float>(min_val, max_val)(rng);
+}
+
+Result* AddResult(const string & name, double tolerance) {
+  Result result = { name, 0, 0.0, 0, tolerance };
+  results.push_back(result);
+  return &results.back();
+}
+
+void Update(Result* result, double deviation) {
+  result->num_case++;
+  result->max_deviation = max(result->max_deviation, deviation);
+  if (deviation > result->tolerance)
+    result->num_mismatch++;
+}
+
+/**
+ * Smooth shading, flat blocks and noise in random proportions, so that LAB
+ * codes, gradients and flat windows all occur.
+ */
+TestImage RandomImage(int32_t width, int32_t height) {
+  TestImage img;
+  img.name = "random " + to_string(width) + "x" + to_string(height);
+  img.width = width;
+  img.height = height;
+  img.data.resize(width * height);
+
+  float gx = RandomFloat(-2.0f, 2.0f);
+  float gy = RandomFloat(-2.0f, 2.0f);
+  int32_t noise = RandomInt(0, 64);
+  int32_t block = RandomInt(4, 32);
+  for (int32_t y = 0; y < height; y++) {
+    for (int32_t x = 0; x < width; x++) {
+      int32_t val = 128 + static_cast<int32_t>(gx * x + gy * y) % 96;
+      if (((x / block) + (y / block)) % 3 == 0)
+        val = 40 + 20 * ((x / block) % 4);
+      else
+        val += RandomInt(-noise, noise);
+      img.data[y * width + x] = static_cast<uint8_t>(min(max(val, 0), 255));
+    }
+  }
+  return img;
+}
+
+bool ReadPGM(const string & path, TestImage* img) {
+  ifstream file(path, ifstream::binary);
+  string magic;
+  int32_t max_val = 0;
+  file >> magic >> img->width >> img->height >> max_val;
+  if (!file || magic != "P5" || img->width <= 0 || img->height <= 0 ||
+      max_val <= 0 || max_val > 255)
+    return false;
+
+  file.get();
+  img->name = path;
+  img->data.resize(img->width * img->height);
+  file.read(reinterpret_cast<char*>(img->data.data()), img->data.size());
+  return !file.fail();
+}
+
+double MaxAbsDiff(const uint8_t* a, const uint8_t* b, int32_t len) {
+  int32_t diff = 0;
+  for (int32_t i = 0; i < len; i++)
+    diff = max(diff, abs(static_cast<int32_t>(a[i]) - b[i]));
+  return diff;
+}
+
+void TestResize(const vector<TestImage> & images) {
+  Result* resize = AddResult("resize", 0.0);
+  for (size_t n = 0; n < images.size(); n++) {
+    seeta::ImageData src = images[n].image();
+    for (int32_t t = 0; t < 8; t++) {
+      seeta::ImageData dest(RandomInt(2, src.width), RandomInt(2, src.height));
+      vector<uint8_t> data(dest.width * dest.height);
+      vector<uint8_t> ref_data(data.size());
+      dest.data = data.data();
+      seeta::fd::ResizeImage(src, &dest);
+      dest.data = ref_data.data();
+      seeta::fd::reference::ResizeImage(src, &dest);
+      Update(resize, MaxAbsDiff(data.data(), ref_data.data(),
+        static_cast<int32_t>(data.size())));
+    }
+  }
+
+  // Levels by the scale plan, one by one and all at once, with any missing or
+  // extra level counted as a mismatch of the largest deviation
+  Result* pyramid = AddResult("image pyramid", 0.0);
+  seeta::fd::ImagePyramid img_pyramid;
+  img_pyramid.SetScaleStep(kScaleStep);
+  img_pyramid.SetMaxScale(1.0f);
+  for (size_t n = 0; n < images.size(); n++) {
+    seeta::ImageData src = images[n].image();
+    float min_scale = static_cast<float>(kWndSize) / min(src.width, src.height);
+    vector<vector<uint8_t> > ref_data;
+    vector<seeta::ScaledImage> ref_levels;
+    seeta::fd::reference::BuildImagePyramid(src, 1.0f, min_scale, kScaleStep,
+      &ref_data, &ref_levels);
+
+    img_pyramid.SetImage1x(src.data, src.width, src.height);
+    img_pyramid.SetMinScale(min_scale);
+    img_pyramid.BuildLevels();
+    int32_t num_level = img_pyramid.num_level();
+    if (num_level != static_cast<int32_t>(ref_levels.size()))
+      Update(pyramid, 255.0);
+    for (int32_t level = 0; level < num_level &&
+        level < static_cast<int32_t>(ref_levels.size()); level++) {
+      const seeta::ImageData & ref = ref_levels[level].image;
+      float scale = 0.0f;
+      const seeta::ImageData* built = img_pyramid.GetLevel(level, &scale);
+      const seeta::ImageData* scaled = img_pyramid.GetScaleImage(level);
+      if (built->width != ref.width || built->height != ref.height ||
+          scaled->width != ref.width || scaled->height != ref.height ||
+          scale != ref_levels[level].scale_factor) {
+        Update(pyramid, 255.0);
+        continue;
+      }
+      int32_t len = ref.width * ref.height;
+      Update(pyramid, max(MaxAbsDiff(built->data, ref.data, len),
+        MaxAbsDiff(scaled->data, ref.data, len)));
+    }
+  }
+}
+
+void TestLAB(const vector<TestImage> & images) {
+  Result* feat = AddResult("LAB feature map", 0.0);
+  Result* std_dev = AddResult("LAB std dev", 0.0);
+  Result* std_dev_mask = AddResult("LAB std dev mask", 0.0);
+  seeta::fd::LABFeatureMap feat_map;
+  vector<uint8_t> ref_feat;
+  vector<uint8_t> padded;
+  vector<uint8_t> mask;
+
+  for (size_t n = 0; n < images.size(); n++) {
+    const TestImage & img = images[n];
+    int32_t width = img.width;
+    int32_t height = img.height;
+    seeta::fd::reference::ComputeLABFeatureMap(img.data.data(), width, height,
+      &ref_feat);
+
+    // Rows read in place with a stride, as done for external scaled images
+    int32_t stride = width + RandomInt(0, 17);
+    padded.assign(stride * height, 0);
+    for (int32_t y = 0; y < height; y++)
+      copy_n(img.data.data() + y * width, width, padded.data() + y * stride);
+
+    for (int32_t pass = 0; pass < 2; pass++) {
+      if (pass == 0)
+        feat_map.Compute(img.data.data(), width, height);
+      else
+        feat_map.Compute(padded.data(), width, height, stride);
+      seeta::Rect all = { 0, 0, width, height };
+      int32_t diff = 0;
+      for (int32_t y = 0; y + 9 <= height; y++) {
+        for (int32_t x = 0; x + 9 <= width; x++) {
+          if (feat_map.GetFeatureVal(all, x, y) != ref_feat[y * width + x])
+            diff = 1;
+        }
+      }
+      Update(feat, diff);
+    }
+
+    for (int32_t t = 0; t < 64 && width >= kWndSize && height >= kWndSize;
+        t++) {
+      seeta::Rect roi = { RandomInt(0, width - kWndSize),
+        RandomInt(0, height - kWndSize), kWndSize, kWndSize };
+      Update(std_dev, fabs(feat_map.GetStdDev(roi) -
+        seeta::fd::reference::GetStdDev(img.data.data(), width, roi)));
+    }
+
+    int32_t step_x = RandomInt(1, 6);
+    int32_t step_y = RandomInt(1, 6);
+    float thresh = RandomFloat(2.0f, 20.0f);
+    feat_map.GetStdDevMask(kWndSize, kWndSize, step_x, step_y, thresh, &mask);
+    int32_t idx = 0;
+    for (int32_t y = 0; y + kWndSize <= height; y += step_y) {
+      for (int32_t x = 0; x + kWndSize <= width; x += step_x, idx++) {
+        seeta::Rect roi = { x, y, kWndSize, kWndSize };
+        uint8_t ref = (seeta::fd::reference::GetStdDev(img.data.data(), width,
+          roi) > thresh ? 1 : 0);
+        Update(std_dev_mask, (idx < static_cast<int32_t>(mask.size()) &&
+          mask[idx] == ref ? 0.0 : 1.0));
+      }
+    }
+  }
+
+  // A bright window of 300x300, whose sum of squares exceeds 32 bits
+  const int32_t kBrightSize = 300;
+  vector<uint8_t> bright(kBrightSize * kBrightSize);
+  for (size_t i = 0; i < bright.size(); i++)
+    bright[i] = static_cast<uint8_t>(RandomInt(224, 255));
+  feat_map.Compute(bright.data(), kBrightSize, kBrightSize);
+  seeta::Rect roi = { 0, 0, kBrightSize, kBrightSize };
+  Update(std_dev, fabs(feat_map.GetStdDev(roi) -
+    seeta::fd::reference::GetStdDev(bright.data(), kBrightSize, roi)));
+}
+
+void TestSURF(const vector<TestImage> & images) {
+  Result* result = AddResult("SURF feature", 1e-6);
+  seeta::fd::SURFFeatureMap feat_map;
+  const seeta::fd::SURFFeaturePool & pool = feat_map.feature_pool();
+  vector<uint8_t> crop;
+  vector<float> feat_vec;
+  vector<float> ref_feat_vec;
+
+  for (size_t n = 0; n < images.size(); n++) {
+    const TestImage & img = images[n];
+    if (img.width < kWndSize || img.height < kWndSize)
+      continue;
+    // Windows at the borders and inside, as the borders are special cases of
+    // both gradients and integral images
+    int32_t width = min(img.width, kWndSize + RandomInt(0, 24));
+    int32_t height = min(img.height, kWndSize + RandomInt(0, 24));
+    crop.resize(width * height);
+    for (int32_t y = 0; y < height; y++)
+      copy_n(img.data.data() + y * img.width, width, crop.data() + y * width);
+
+    feat_map.Compute(crop.data(), width, height);
+    for (int32_t t = 0; t < 3; t++) {
+      seeta::Rect roi = { (t == 0 ? 0 : RandomInt(0, width - kWndSize)),
+        (t == 0 ? 0 : RandomInt(0, height - kWndSize)), kWndSize, kWndSize };
+      feat_map.SetROI(roi);
+      for (int32_t id = 0; id < static_cast<int32_t>(pool.size()); id++) {
+        feat_vec.resize(feat_map.GetFeatureVectorDim(id));
+        feat_map.GetFeatureVector(id, feat_vec.data());
+        seeta::fd::reference::ComputeSURFFeature(crop.data(), width, height,
+          roi, pool[id], &ref_feat_vec);
+        double diff = (feat_vec.size() != ref_feat_vec.size() ? 1.0 : 0.0);
+        for (size_t i = 0; i < feat_vec.size() && diff == 0.0; i++)
+          diff = max<double>(diff, fabs(feat_vec[i] - ref_feat_vec[i]));
+        Update(result, diff);
+      }
+    }
+  }
+}
+
+void TestMLP() {
+  // Shapes of the frontal model, and odd ones for the tails of SIMD loops.
+  // MLP takes at least two layers.
+  const vector<vector<int32_t> > shapes = {
+    { 128, 20, 4 }, { 256, 40, 4 }, { 512, 256, 128, 64, 4 }, { 37, 13, 3 },
+    { 5, 3, 1 }
+  };
+  Result* result = AddResult("MLP", 1e-4);
+  for (size_t s = 0; s < shapes.size(); s++) {
+    seeta::fd::MLP mlp;
+    vector<seeta::fd::reference::MLPLayer> layers;
+    for (size_t i = 0; i + 1 < shapes[s].size(); i++) {
+      seeta::fd::reference::MLPLayer layer;
+      layer.input_dim = shapes[s][i];
+      layer.output_dim = shapes[s][i + 1];
+      float range = 1.0f / sqrt(static_cast<float>(layer.input_dim));
+      for (int32_t j = 0; j < layer.input_dim * layer.output_dim; j++)
+        layer.weights.push_back(RandomFloat(-range, range));
+      for (int32_t j = 0; j < layer.output_dim; j++)
+        layer.bias.push_back(RandomFloat(-0.1f, 0.1f));
+      mlp.AddLayer(layer.input_dim, layer.output_dim, layer.weights.data(),
+        layer.bias.data(), i + 2 == shapes[s].size());
+      layers.push_back(layer);
+    }
+
+    vector<float> input(shapes[s][0]);
+    vector<float> output(shapes[s].back());
+    vector<float> ref_output;
+    for (int32_t t = 0; t < 32; t++) {
+      for (size_t i = 0; i < input.size(); i++)
+        input[i] = RandomFloat(-1.0f, 1.0f);
+      mlp.Compute(input.data(), output.data());
+      seeta::fd::reference::ComputeMLP(layers, input.data(), &ref_output);
+      double diff = 0.0;
+      for (size_t i = 0; i < output.size(); i++)
+        diff = max<double>(diff, fabs(output[i] - ref_output[i]));
+      Update(result, diff);
+    }
+  }
+}
+
+bool IsSameFace(const seeta::FaceInfo & a, const seeta::FaceInfo & b) {
+  return a.bbox.x == b.bbox.x && a.bbox.y == b.bbox.y &&
+    a.bbox.width == b.bbox.width && a.bbox.height == b.bbox.height &&
+    a.score == b.score;
+}
+
+void TestNMS() {
+  Result* result = AddResult("NMS", 0.0);
+  vector<seeta::FaceInfo> bboxes;
+  vector<seeta::FaceInfo> bboxes_nms;
+  vector<seeta::FaceInfo> ref_bboxes_nms;
+  for (int32_t t = 0; t < 200; t++) {
+    // Clusters of jittered boxes, as sliding windows give around a face
+    bboxes.clear();
+    int32_t num_cluster = RandomInt(1, 6);
+    for (int32_t c = 0; c < num_cluster; c++) {
+      int32_t x = RandomInt(0, 400);
+      int32_t y = RandomInt(0, 300);
+      int32_t size = RandomInt(20, 120);
+      int32_t num_bbox = RandomInt(1, 30);
+      for (int32_t i = 0; i < num_bbox; i++) {
+        seeta::FaceInfo info;
+        int32_t jitter = size / 4;
+        info.bbox.x = x + RandomInt(-jitter, jitter);
+        info.bbox.y = y + RandomInt(-jitter, jitter);
+        info.bbox.width = info.bbox.height = size + RandomInt(-jitter, jitter);
+        // Ties of scores are common among LAB windows
+        info.score = static_cast<float>(RandomInt(0, 50)) * 0.5f;
+        info.roll = info.pitch = info.yaw = 0.0;
+        bboxes.push_back(info);
+      }
+    }
+
+    float iou_thresh = (t % 2 == 0 ? 0.3f : 0.8f);
+    seeta::fd::reference::NonMaximumSuppression(bboxes, &ref_bboxes_nms,
+      iou_thresh);
+    seeta::fd::NonMaximumSuppression(&bboxes, &bboxes_nms, iou_thresh);
+    double diff = (bboxes_nms.size() != ref_bboxes_nms.size() ? 1.0 : 0.0);
+    for (size_t i = 0; i < bboxes_nms.size() && diff == 0.0; i++)
+      diff = (IsSameFace(bboxes_nms[i], ref_bboxes_nms[i]) ? 0.0 : 1.0);
+    Update(result, diff);
+  }
+}
+
+/**
+ * Faces of two paths are the same if they have the same boxes and scores,
+ * in any order, as ties of scores may be sorted either way.
+ */
+void CompareFaces(const vector<seeta::FaceInfo> & faces,
+    const vector<seeta::FaceInfo> & ref_faces, Result* result) {
+  vector<seeta::FaceInfo> a(faces);
+  vector<seeta::FaceInfo> b(ref_faces);
+  auto is_before = [](const seeta::FaceInfo & x, const seeta::FaceInfo & y) {
+    if (x.score != y.score)
+      return x.score > y.score;
+    if (x.bbox.x != y.bbox.x)
+      return x.bbox.x < y.bbox.x;
+    if (x.bbox.y != y.bbox.y)
+      return x.bbox.y < y.bbox.y;
+    return x.bbox.width < y.bbox.width;
+  };
+  sort(a.begin(), a.end(), is_before);
+  sort(b.begin(), b.end(), is_before);
+  double diff = (a.size() != b.size() ? 1.0 : 0.0);
+  for (size_t i = 0; i < a.size() && diff == 0.0; i++)
+    diff = (IsSameFace(a[i], b[i]) ? 0.0 : 1.0);
+  Update(result, diff);
+}
+
+/** Every pixel moved towards the middle by more than the motion threshold */
+TestImage LowerContrast(const TestImage & img) {
+  TestImage frame = img;
+  frame.name = img.name + " at lower contrast";
+  for (size_t i = 0; i < frame.data.size(); i++)
+    frame.data[i] = static_cast<uint8_t>(frame.data[i] < 128 ?
+      frame.data[i] + 20 : frame.data[i] - 20);
+  return frame;
+}
+
+/** A flat block over the middle, which changes only some cells */
+TestImage PatchCenter(const TestImage & img) {
+  TestImage frame = img;
+  frame.name = img.name + " with a patch";
+  for (int32_t y = img.height / 3; y < img.height / 2; y++) {
+    for (int32_t x = img.width / 3; x < img.width / 2; x++)
+      frame.data[y * img.width + x] = 128;
+  }
+  return frame;
+}
+
+/**
+ * Faces found on scaled images made by the reference kernels are the ground
+ * truth for the internal image pyramid and the other detection paths, all of
+ * which give exactly the same faces by design.
+ */
+class DetectionTest {
+ public:
+  explicit DetectionTest(const string & model_path)
+      : model_path_(model_path), detector_(model_path.c_str()) {
+    detector_.SetMinFaceSize(kMinFaceSize);
+    detector_.SetImagePyramidScaleFactor(kScaleStep);
+    fust_.LoadModel(model_path);
+    fust_.SetWindowSize(kWndSize);
+    img_pyramid_.SetScaleStep(kScaleStep);
+    img_pyramid_.SetMaxScale(static_cast<float>(kWndSize) / kMinFaceSize);
+
+    found_ = AddResult("reference faces", 0.0);
+    full_ = AddResult("detect", 0.0);
+    roi_ = AddResult("detect in ROI", 0.0);
+    budget_ = AddResult("detect in budget", 0.0);
+    scan_ = AddResult("scan in bands", 0.0);
+    incremental_ = AddResult("detect incremental", 0.0);
+    gated_ = AddResult("detect gated", 0.0);
+    adaptive_ = AddResult("detect adaptive", 0.0);
+    levels_ = AddResult("face levels", 0.0);
+    multi_model_ = AddResult("detect multi-model", 0.0);
+    batch_ = AddResult("detect in batch", 0.0);
+  }
+
+  void Run(const vector<TestImage> & images);
+
+ private:
+  void DetectReference(const seeta::ImageData & img,
+    vector<seeta::FaceInfo>* faces);
+  void TestScan(const seeta::ImageData & img);
+  void TestFrames(const TestImage & img);
+  void TestAdaptiveScales(const TestImage & img);
+  void TestMultiModel(const seeta::ImageData & img,
+    const vector<seeta::FaceInfo> & ref_faces);
+  void TestBatch(const vector<TestImage> & images,
+    const vector<vector<seeta::FaceInfo> > & ref_faces);
+
+  string model_path_;
+  seeta::FaceDetection detector_;
+  seeta::fd::FuStDetector fust_;
+  seeta::fd::ImagePyramid img_pyramid_;
+  vector<vector<uint8_t> > ref_data_;
+  vector<seeta::ScaledImage> ref_levels_;
+
+  Result* found_;
+  Result* full_;
+  Result* roi_;
+  Result* budget_;
+  Result* scan_;
+  Result* incremental_;
+  Result* gated_;
+  Result* adaptive_;
+  Result* levels_;
+  Result* multi_model_;
+  Result* batch_;
+};
+
+void DetectionTest::DetectReference(const seeta::ImageData & img,
+    vector<seeta::FaceInfo>* faces) {
+  float min_scale = static_cast<float>(kWndSize) / min(img.width, img.height);
+  seeta::fd::reference::BuildImagePyramid(img, 1.0f, min_scale, kScaleStep,
+    &ref_data_, &ref_levels_);
+  detector_.Detect(img, ref_levels_, faces);
+}
+
+/**
+ * Levels scanned in row bands on several threads against the plain loop over
+ * each level, which a motion mask with all cells active falls back to.
+ */
+void DetectionTest::TestScan(const seeta::ImageData & img) {
+  vector<seeta::FaceInfo> faces;
+  vector<seeta::FaceInfo> ref_faces;
+  img_pyramid_.SetImage1x(img.data, img.width, img.height);
+  img_pyramid_.SetMinScale(static_cast<float>(kWndSize) /
+    min(img.width, img.height));
+  fust_.Detect(&img_pyramid_, &faces);
+
+  seeta::fd::CellMask all_cells;
+  all_cells.Reset(img.width, img.height, true);
+  all_cells.BuildIndex();
+  fust_.SetMotionMask(&all_cells);
+  img_pyramid_.SetImage1x(img.data, img.width, img.height);
+  fust_.Detect(&img_pyramid_, &ref_faces);
+  fust_.SetMotionMask(nullptr);
+  CompareFaces(faces, ref_faces, scan_);
+}
+
+/**
+ * Frames of a static camera: the same one again, one changed in the middle and
+ * one changed everywhere. Incremental detection gives the faces of a full
+ * detection on all of them, and motion gating on those scanned in full, i.e.
+ * the first one and the one changed everywhere.
+ */
+void DetectionTest::TestFrames(const TestImage & img) {
+  vector<TestImage> frames;
+  frames.push_back(img);
+  frames.push_back(img);
+  frames.push_back(PatchCenter(img));
+  frames.push_back(LowerContrast(img));
+
+  seeta::FaceDetection incremental_detector(model_path_.c_str());
+  incremental_detector.SetMinFaceSize(kMinFaceSize);
+  incremental_detector.SetImagePyramidScaleFactor(kScaleStep);
+  incremental_detector.SetIncrementalDetection(true);
+  seeta::FaceDetection gated_detector(model_path_.c_str());
+  gated_detector.SetMinFaceSize(kMinFaceSize);
+  gated_detector.SetImagePyramidScaleFactor(kScaleStep);
+  gated_detector.SetMotionGating(true, 100);
+
+  vector<seeta::FaceInfo> faces;
+  vector<seeta::FaceInfo> ref_faces;
+  for (size_t n = 0; n < frames.size(); n++) {
+    seeta::ImageData frame = frames[n].image();
+    DetectReference(frame, &ref_faces);
+    incremental_detector.Detect(frame, &faces);
+    CompareFaces(faces, ref_faces, incremental_);
+    gated_detector.Detect(frame, &faces);
+    if (n == 0 || n == frames.size() - 1)
+      CompareFaces(faces, ref_faces, gated_);
+  }
+}
+
+/**
+ * Frames of a fixed camera with scales skipped, of which the first one and
+ * the one at the scan interval scan all scales. Levels kept for the faces are
+ * those of the reference image pyramid.
+ */
+void DetectionTest::TestAdaptiveScales(const TestImage & img) {
+  const int32_t kScanInterval = 3;
+  seeta::FaceDetection detector(model_path_.c_str());
+  detector.SetMinFaceSize(kMinFaceSize);
+  detector.SetImagePyramidScaleFactor(kScaleStep);
+  detector.SetAdaptiveScales(true, kScanInterval);
+
+  seeta::ImageData frame = img.image();
+  vector<seeta::FaceInfo> faces;
+  vector<seeta::FaceInfo> ref_faces;
+  vector<seeta::FaceLevel> face_levels;
+  DetectReference(frame, &ref_faces);
+  for (int32_t n = 0; n <= kScanInterval; n++) {
+    detector.Detect(frame, &faces, &face_levels);
+    if (n != 0 && n != kScanInterval)
+      continue;
+    CompareFaces(faces, ref_faces, adaptive_);
+
+    for (size_t i = 0; i < face_levels.size(); i++) {
+      int32_t level = face_levels[i].level;
+      const seeta::ScaledImage & image = face_levels[i].image;
+      if (level < 0 || level >= static_cast<int32_t>(ref_levels_.size()) ||
+          image.image.width != ref_levels_[level].image.width ||
+          image.image.height != ref_levels_[level].image.height ||
+          image.scale_factor != ref_levels_[level].scale_factor) {
+        Update(levels_, 255.0);
+        continue;
+      }
+      double diff = 0.0;
+      for (int32_t y = 0; y < image.image.height; y++) {
+        diff = max(diff, MaxAbsDiff(image.image.data + y * image.stride,
+          ref_levels_[level].image.data + y * ref_levels_[level].stride,
+          image.image.width));
+      }
+      Update(levels_, diff);
+    }
+  }
+}
+
+/**
+ * A second copy of the model finds the same faces, which are merged with
+ * those of the first one.
+ */
+void DetectionTest::TestMultiModel(const seeta::ImageData & img,
+    const vector<seeta::FaceInfo> & ref_faces) {
+  seeta::FaceDetection detector(model_path_.c_str());
+  detector.SetMinFaceSize(kMinFaceSize);
+  detector.SetImagePyramidScaleFactor(kScaleStep);
+  detector.AddModel(model_path_.c_str());
+  vector<seeta::FaceInfo> faces;
+  detector.Detect(img, &faces);
+  CompareFaces(faces, ref_faces, multi_model_);
+}
+
+/** All images at once, packed into shared atlases */
+void DetectionTest::TestBatch(const vector<TestImage> & images,
+    const vector<vector<seeta::FaceInfo> > & ref_faces) {
+  vector<seeta::ImageData> batch;
+  for (size_t n = 0; n < images.size(); n++)
+    batch.push_back(images[n].image());
+  vector<vector<seeta::FaceInfo> > batch_faces;
+  detector_.Detect(batch, &batch_faces);
+  for (size_t n = 0; n < images.size(); n++)
+    CompareFaces(batch_faces[n], ref_faces[n], batch_);
+}
+
+void DetectionTest::Run(const vector<TestImage> & images) {
+  int64_t num_face = 0;
+  vector<TestImage> detect_images;
+  vector<vector<seeta::FaceInfo> > ref_faces;
+  vector<seeta::FaceInfo> faces;
+
+  for (size_t n = 0; n < images.size(); n++) {
+    seeta::ImageData img = images[n].image();
+    if (min(img.width, img.height) < kMinFaceSize)
+      continue;
+    detect_images.push_back(images[n]);
+    ref_faces.push_back(vector<seeta::FaceInfo>());
+    DetectReference(img, &(ref_faces.back()));
+    num_face += ref_faces.back().size();
+
+    detector_.Detect(img, &faces);
+    CompareFaces(faces, ref_faces.back(), full_);
+
+    vector<seeta::Rect> rois(1, seeta::Rect());
+    rois[0].x = rois[0].y = 0;
+    rois[0].width = img.width;
+    rois[0].height = img.height;
+    detector_.Detect(img, rois, &faces);
+    CompareFaces(faces, ref_faces.back(), roi_);
+
+    detector_.Detect(img, 1e9, &faces);
+    CompareFaces(faces, ref_faces.back(), budget_);
+
+    TestScan(img);
+    TestFrames(images[n]);
+    TestAdaptiveScales(images[n]);
+    TestMultiModel(img, ref_faces.back());
+  }
+  TestBatch(detect_images, ref_faces);
+
+  // Without faces, the paths above would agree on nothing
+  printf("Reference detection found %lld faces\n",
+    static_cast<long long>(num_face));
+  Update(found_, (num_face > 0 ? 0.0 : 1.0));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    cout << "Usage: " << argv[0] << " model_path [image_path ...]" << endl
+      << "  Optimized kernels and detection paths are checked against the"
+      << " reference kernels, on random images and the given binary PGM"
+      << " images. Returns non-zero if any of them disagree, or if no face"
+      << " is found in the images." << endl;
+    return -1;
+  }
+
+  vector<TestImage> images;
+  const int32_t sizes[][2] = {
+    { 40, 40 }, { 41, 57 }, { 64, 48 }, { 97, 131 }, { 160, 120 },
+    { 255, 190 }, { 320, 240 }
+  };
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    images.push_back(RandomImage(sizes[i][0], sizes[i][1]));
+  for (int32_t i = 2; i < argc; i++) {
+    TestImage img;
+    if (ReadPGM(argv[i], &img))
+      images.push_back(img);
+    else
+      cout << "Skipped, not a binary PGM image: " << argv[i] << endl;
+  }
+
+  TestResize(images);
+  TestLAB(images);
+  TestSURF(images);
+  TestMLP();
+  TestNMS();
+  DetectionTest(argv[1]).Run(images);
+
+  bool is_passed = true;
+  printf("%-18s %8s %14s %11s %10s  %s\n", "kernel", "cases", "max deviation",
+    "mismatches", "tolerance", "result");
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result & result = results[i];
+    bool is_ok = (result.num_mismatch == 0);
+    is_passed = is_passed && is_ok;
+    printf("%-18s %8lld %14.3g %11lld %10.3g  %s\n", result.name.c_str(),
+      static_cast<long long>(result.num_case), result.max_deviation,
+      static_cast<long long>(result.num_mismatch), result.tolerance,
+      (is_ok ? "PASS" : "FAIL"));
+  }
+  return (is_passed ? 0 : 1);
+}
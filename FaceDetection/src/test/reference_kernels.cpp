@@ -0,0 +1,250 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is an example of how to use SeetaFace engine for face detection, the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include "reference_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace seeta {
+namespace fd {
+namespace reference {
+
+void ResizeImage(const seeta::ImageData & src, seeta::ImageData* dest) {
+  int32_t src_width = src.width;
+  int32_t src_height = src.height;
+  if (src_width == dest->width && src_height == dest->height) {
+    std::memcpy(dest->data, src.data, src_width * src_height);
+    return;
+  }
+
+  double scale_x = static_cast<double>(src_width) / dest->width;
+  double scale_y = static_cast<double>(src_height) / dest->height;
+  for (int32_t y = 0; y < dest->height; y++) {
+    for (int32_t x = 0; x < dest->width; x++) {
+      double src_x = scale_x * x;
+      double src_y = scale_y * y;
+      int32_t x0 = std::min(static_cast<int32_t>(src_x), src_width - 2);
+      int32_t y0 = std::min(static_cast<int32_t>(src_y), src_height - 2);
+      double weight_x = src_x - x0;
+      double weight_y = src_y - y0;
+
+      const uint8_t* p = src.data + y0 * src_width + x0;
+      double val = (1 - weight_y) * ((1 - weight_x) * p[0] + weight_x * p[1]) +
+        weight_y * ((1 - weight_x) * p[src_width] +
+        weight_x * p[src_width + 1]);
+      dest->data[y * dest->width + x] = static_cast<uint8_t>(val);
+    }
+  }
+}
+
+void BuildImagePyramid(const seeta::ImageData & img, float max_scale,
+    float min_scale, float scale_step, std::vector<std::vector<uint8_t> >* data,
+    std::vector<seeta::ScaledImage>* levels) {
+  data->clear();
+  levels->clear();
+  for (float scale = max_scale; scale >= min_scale; scale *= scale_step) {
+    seeta::ImageData img_scaled(static_cast<int32_t>(img.width * scale),
+      static_cast<int32_t>(img.height * scale), 1);
+    data->push_back(std::vector<uint8_t>(img_scaled.width * img_scaled.height));
+    img_scaled.data = data->back().data();
+    ResizeImage(img, &img_scaled);
+
+    seeta::ScaledImage level;
+    level.image = img_scaled;
+    level.stride = img_scaled.width;
+    level.scale_factor = scale;
+    levels->push_back(level);
+  }
+  // Pointers are taken again, as `data` may have been reallocated
+  for (size_t i = 0; i < levels->size(); i++)
+    (*levels)[i].image.data = (*data)[i].data();
+}
+
+namespace {
+
+int32_t RectSum(const uint8_t* img, int32_t width, int32_t x, int32_t y) {
+  int32_t sum = 0;
+  for (int32_t r = 0; r < 3; r++) {
+    for (int32_t c = 0; c < 3; c++)
+      sum += img[(y + r) * width + x + c];
+  }
+  return sum;
+}
+
+}  // namespace
+
+void ComputeLABFeatureMap(const uint8_t* img, int32_t width, int32_t height,
+    std::vector<uint8_t>* feat_map) {
+  feat_map->assign(width * height, 0);
+  for (int32_t y = 0; y + 9 <= height; y++) {
+    for (int32_t x = 0; x + 9 <= width; x++) {
+      int32_t center = RectSum(img, width, x + 3, y + 3);
+      uint8_t code = 0;
+      for (int32_t i = 0; i < 3; i++) {
+        for (int32_t j = 0; j < 3; j++) {
+          if (i == 1 && j == 1)
+            continue;
+          code = static_cast<uint8_t>(code << 1);
+          if (center >= RectSum(img, width, x + j * 3, y + i * 3))
+            code |= 1;
+        }
+      }
+      (*feat_map)[y * width + x] = code;
+    }
+  }
+}
+
+float GetStdDev(const uint8_t* img, int32_t width, const seeta::Rect & roi) {
+  double area = roi.width * roi.height;
+  double sum = 0.0;
+  double square_sum = 0.0;
+  for (int32_t y = roi.y; y < roi.y + roi.height; y++) {
+    for (int32_t x = roi.x; x < roi.x + roi.width; x++) {
+      double val = img[y * width + x];
+      sum += val;
+      square_sum += val * val;
+    }
+  }
+  double mean = sum / area;
+  double m2 = square_sum / area;
+  return static_cast<float>(std::sqrt(m2 - mean * mean));
+}
+
+void ComputeSURFFeature(const uint8_t* img, int32_t width, int32_t height,
+    const seeta::Rect & roi, const seeta::fd::SURFFeature & feat,
+    std::vector<float>* feat_vec) {
+  int32_t cell_width = feat.patch.width / feat.num_cell_per_row;
+  int32_t cell_height = feat.patch.height / feat.num_cell_per_col;
+  std::vector<int32_t> sums;
+  for (int32_t i = 0; i < feat.num_cell_per_col; i++) {
+    for (int32_t j = 0; j < feat.num_cell_per_row; j++) {
+      int32_t cell_sum[8] = { 0 };
+      int32_t x0 = roi.x + feat.patch.x + j * cell_width;
+      int32_t y0 = roi.y + feat.patch.y + i * cell_height;
+      for (int32_t y = y0; y < y0 + cell_height; y++) {
+        for (int32_t x = x0; x < x0 + cell_width; x++) {
+          const uint8_t* p = img + y * width + x;
+          int32_t dx = (x == 0 ? 2 * (p[1] - p[0]) :
+            (x == width - 1 ? 2 * (p[0] - p[-1]) : p[1] - p[-1]));
+          int32_t dy = (y == 0 ? 2 * (p[width] - p[0]) :
+            (y == height - 1 ? 2 * (p[0] - p[-width]) : p[width] - p[-width]));
+          int32_t* dx_sum = cell_sum + (dy >= 0 ? 0 : 2);
+          int32_t* dy_sum = cell_sum + (dx >= 0 ? 4 : 6);
+          dx_sum[0] += dx;
+          dx_sum[1] += std::abs(dx);
+          dy_sum[0] += dy;
+          dy_sum[1] += std::abs(dy);
+        }
+      }
+      sums.insert(sums.end(), cell_sum, cell_sum + 8);
+    }
+  }
+
+  double prod = 0.0;
+  for (size_t i = 0; i < sums.size(); i++) {
+    uint32_t val = static_cast<uint32_t>(sums[i]);
+    prod += static_cast<double>(static_cast<int32_t>(val * val));
+  }
+  feat_vec->assign(sums.size(), 0.0f);
+  if (prod != 0) {
+    float norm_l2 = static_cast<float>(std::sqrt(prod));
+    for (size_t i = 0; i < sums.size(); i++)
+      (*feat_vec)[i] = sums[i] / norm_l2;
+  }
+}
+
+void ComputeMLP(const std::vector<MLPLayer> & layers, const float* input,
+    std::vector<float>* output) {
+  std::vector<float> layer_input(input, input + layers[0].input_dim);
+  for (size_t n = 0; n < layers.size(); n++) {
+    const MLPLayer & layer = layers[n];
+    output->assign(layer.output_dim, 0.0f);
+    for (int32_t i = 0; i < layer.output_dim; i++) {
+      float val = 0.0f;
+      for (int32_t j = 0; j < layer.input_dim; j++)
+        val += layer_input[j] * layer.weights[i * layer.input_dim + j];
+      val += layer.bias[i];
+      if (n + 1 < layers.size())
+        (*output)[i] = (val > 0.0f ? val : 0.0f);
+      else
+        (*output)[i] = 1.0f / (1.0f + std::exp(-val));
+    }
+    layer_input.swap(*output);
+  }
+  output->swap(layer_input);
+}
+
+void NonMaximumSuppression(std::vector<seeta::FaceInfo> bboxes,
+    std::vector<seeta::FaceInfo>* bboxes_nms, float iou_thresh) {
+  bboxes_nms->clear();
+  std::sort(bboxes.begin(), bboxes.end(),
+    [](const seeta::FaceInfo & a, const seeta::FaceInfo & b) {
+      return a.score > b.score;
+    });
+
+  std::vector<bool> is_merged(bboxes.size(), false);
+  for (size_t i = 0; i < bboxes.size(); i++) {
+    if (is_merged[i])
+      continue;
+    bboxes_nms->push_back(bboxes[i]);
+    const seeta::Rect & a = bboxes[i].bbox;
+    float area_a = static_cast<float>(a.width * a.height);
+
+    for (size_t j = i + 1; j < bboxes.size(); j++) {
+      if (is_merged[j])
+        continue;
+      // Boxes cover pixels [x, x + width - 1], as in the original
+      const seeta::Rect & b = bboxes[j].bbox;
+      float x = static_cast<float>(std::max(a.x, b.x));
+      float y = static_cast<float>(std::max(a.y, b.y));
+      float w = static_cast<float>(std::min(a.x + a.width - 1,
+        b.x + b.width - 1)) - x + 1;
+      float h = static_cast<float>(std::min(a.y + a.height - 1,
+        b.y + b.height - 1)) - y + 1;
+      if (w <= 0 || h <= 0)
+        continue;
+
+      float area_intersect = w * h;
+      float area_b = static_cast<float>(b.width * b.height);
+      if (area_intersect / (area_a + area_b - area_intersect) > iou_thresh) {
+        is_merged[j] = true;
+        bboxes_nms->back().score += bboxes[j].score;
+      }
+    }
+  }
+}
+
+}  // namespace reference
+}  // namespace fd
+}  // namespace seeta
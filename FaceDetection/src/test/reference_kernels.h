@@ -0,0 +1,113 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is an example of how to use SeetaFace engine for face detection, the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#ifndef SEETA_FD_TEST_REFERENCE_KERNELS_H_
+#define SEETA_FD_TEST_REFERENCE_KERNELS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+#include "feat/surf_feature_map.h"
+
+namespace seeta {
+namespace fd {
+namespace reference {
+
+/**
+ * Plain scalar versions of the kernels of the detector, written for clarity
+ * rather than speed, as the ground truth for differential tests. Each one
+ * keeps the arithmetic of the original implementation, so optimized kernels
+ * are expected to match them exactly unless noted.
+ */
+
+/** @brief Bilinear resizing with weights computed in double precision */
+void ResizeImage(const seeta::ImageData & src, seeta::ImageData* dest);
+
+/**
+ * @brief Scaled images of an image pyramid, from `max_scale` down to no less
+ * than `min_scale`, each smaller by `scale_step`.
+ *
+ * `levels` point into `data`, which holds the pixels.
+ */
+void BuildImagePyramid(const seeta::ImageData & img, float max_scale,
+  float min_scale, float scale_step, std::vector<std::vector<uint8_t> >* data,
+  std::vector<seeta::ScaledImage>* levels);
+
+/**
+ * @brief LAB feature of every position whose 9x9 neighborhood lies inside
+ * the image, and 0 elsewhere.
+ *
+ * Each bit is set if the sum of the center 3x3 rectangle is no less than
+ * that of one of its 8 neighbors, taken in raster order from the top left
+ * one at the highest bit.
+ */
+void ComputeLABFeatureMap(const uint8_t* img, int32_t width, int32_t height,
+  std::vector<uint8_t>* feat_map);
+
+/** @brief Standard deviation of the pixels of `roi` */
+float GetStdDev(const uint8_t* img, int32_t width, const seeta::Rect & roi);
+
+/**
+ * @brief SURF feature of a patch relative to `roi`, normalized by L2 norm.
+ *
+ * Gradients are central differences, doubled one-sided ones at the borders.
+ * Each cell gives 8 sums: dx and |dx| over pixels with dy >= 0 and dy < 0,
+ * then dy and |dy| over pixels with dx >= 0 and dx < 0. The norm is taken
+ * over squares computed in 32 bits, as the original implementation does.
+ */
+void ComputeSURFFeature(const uint8_t* img, int32_t width, int32_t height,
+  const seeta::Rect & roi, const seeta::fd::SURFFeature & feat,
+  std::vector<float>* feat_vec);
+
+/** @struct MLPLayer
+ *  @brief A fully connected layer, with weights stored row by row.
+ */
+typedef struct MLPLayer {
+  int32_t input_dim;
+  int32_t output_dim;
+  std::vector<float> weights;
+  std::vector<float> bias;
+} MLPLayer;
+
+/** @brief ReLU on hidden layers and sigmoid on the output layer */
+void ComputeMLP(const std::vector<MLPLayer> & layers, const float* input,
+  std::vector<float>* output);
+
+/** @brief NMS accumulating the scores of merged boxes, on a sorted copy */
+void NonMaximumSuppression(std::vector<seeta::FaceInfo> bboxes,
+  std::vector<seeta::FaceInfo>* bboxes_nms, float iou_thresh);
+
+}  // namespace reference
+}  // namespace fd
+}  // namespace seeta
+
+#endif  // SEETA_FD_TEST_REFERENCE_KERNELS_H_
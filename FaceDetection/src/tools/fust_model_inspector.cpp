@@ -0,0 +1,309 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is an example of how to use SeetaFace engine for face detection, the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "classifier/lab_boosted_classifier.h"
+#include "classifier/mlp.h"
+#include "classifier/surf_mlp.h"
+#include "feat/surf_feature_map.h"
+#include "fust.h"
+#include "util/image_pyramid.h"
+
+using namespace std;
+
+namespace {
+
+const int32_t kWndSize = 40;
+const int32_t kWndStep = 4;
+const int32_t kMinFaceSize = 40;
+const float kScaleStep = 0.8f;
+
+/** @brief Position of a stage in the model */
+typedef struct StagePos {
+  int32_t hierarchy;
+  int32_t classifier;
+  int32_t stage;
+} StagePos;
+
+/** @brief Estimated cost of a stage for one window */
+typedef struct StageCost {
+  int64_t flops;
+  int64_t bytes;
+} StageCost;
+
+bool ReadPGM(const string & path, vector<uint8_t>* data, int32_t* width,
+    int32_t* height) {
+  ifstream file(path, ifstream::binary);
+  string magic;
+  int32_t max_val = 0;
+  file >> magic;
+  // Skip comments between the fields of the header
+  for (int32_t* field : { width, height, &max_val }) {
+    file >> ws;
+    while (file.peek() == '#') {
+      file.ignore(1 << 16, '\n');
+      file >> ws;
+    }
+    file >> *field;
+  }
+  if (!file || magic != "P5" || *width <= 0 || *height <= 0 ||
+      max_val <= 0 || max_val > 255)
+    return false;
+
+  file.get();
+  data->resize(static_cast<size_t>(*width) * (*height));
+  file.read(reinterpret_cast<char*>(data->data()), data->size());
+  return !file.fail();
+}
+
+/**
+ * LAB: one table lookup and add per base classifier, and a comparison per
+ * group, all of them for windows which pass. SURF-MLP: a multiply and add
+ * per weight, and about 6 operations per feature dimension to sum up cells
+ * on the integral images and normalize, without the feature map itself.
+ */
+StageCost EstimateCost(seeta::fd::Classifier* model,
+    const seeta::fd::SURFFeatureMap & surf_feat_map) {
+  StageCost cost = { 0, 0 };
+  if (model->type() == seeta::fd::ClassifierType::LAB_Boosted_Classifier) {
+    seeta::fd::LABBoostedClassifier* lab =
+      dynamic_cast<seeta::fd::LABBoostedClassifier*>(model);
+    int32_t num_base = lab->num_base_classifier();
+    int32_t num_bin = (num_base > 0 ? lab->base_classifier(0).num_bin() : 0);
+    cost.flops = num_base + num_base / lab->feat_group_size();
+    cost.bytes = static_cast<int64_t>(num_base) *
+      ((num_bin + 1) * sizeof(float) + sizeof(float) +
+      sizeof(seeta::fd::LABFeature));
+  } else {
+    seeta::fd::SURFMLP* surf_mlp = dynamic_cast<seeta::fd::SURFMLP*>(model);
+    const seeta::fd::MLP & mlp = surf_mlp->model();
+    for (int32_t i = 0; i < mlp.GetLayerNum(); i++) {
+      int64_t input_dim = mlp.GetLayer(i).GetInputDim();
+      int64_t output_dim = mlp.GetLayer(i).GetOutputDim();
+      cost.flops += 2 * input_dim * output_dim + output_dim;
+      cost.bytes += (input_dim + 1) * output_dim * sizeof(float);
+    }
+    const vector<int32_t> & feat_id = surf_mlp->feat_id();
+    for (size_t i = 0; i < feat_id.size(); i++)
+      cost.flops += 6 * surf_feat_map.GetFeatureVectorDim(feat_id[i]);
+    cost.bytes += feat_id.size() * sizeof(int32_t);
+  }
+  return cost;
+}
+
+void PrintStage(seeta::fd::Classifier* model,
+    const seeta::fd::SURFFeatureMap & surf_feat_map) {
+  if (model->type() == seeta::fd::ClassifierType::LAB_Boosted_Classifier) {
+    seeta::fd::LABBoostedClassifier* lab =
+      dynamic_cast<seeta::fd::LABBoostedClassifier*>(model);
+    int32_t num_base = lab->num_base_classifier();
+    printf("LAB boosted, %d base classifiers of %d bins, "
+      "threshold tested every %d", num_base,
+      (num_base > 0 ? lab->base_classifier(0).num_bin() : 0),
+      lab->feat_group_size());
+    if (lab->use_std_dev())
+      printf(", std dev > %g", lab->std_dev_thresh());
+    printf("\n");
+    return;
+  }
+
+  seeta::fd::SURFMLP* surf_mlp = dynamic_cast<seeta::fd::SURFMLP*>(model);
+  const seeta::fd::MLP & mlp = surf_mlp->model();
+  const vector<int32_t> & feat_id = surf_mlp->feat_id();
+  printf("SURF-MLP, threshold %g, layers %d", surf_mlp->threshold(),
+    mlp.GetInputDim());
+  for (int32_t i = 0; i < mlp.GetLayerNum(); i++)
+    printf("-%d", mlp.GetLayer(i).GetOutputDim());
+  printf(", %zu features:\n", feat_id.size());
+
+  const seeta::fd::SURFFeaturePool & pool = surf_feat_map.feature_pool();
+  for (size_t i = 0; i < feat_id.size(); i++) {
+    const seeta::fd::SURFFeature & feat = pool[feat_id[i] - 1];
+    printf("        id %5d: patch (%2d, %2d) %2dx%-2d  cells %dx%d  dim %d\n",
+      feat_id[i], feat.patch.x, feat.patch.y, feat.patch.width,
+      feat.patch.height, feat.num_cell_per_row, feat.num_cell_per_col,
+      surf_feat_map.GetFeatureVectorDim(feat_id[i]));
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    cout << "Usage: " << argv[0] << " model_path [image_path ...]" << endl
+      << "  Images are binary PGM files, on which the stages are profiled"
+      << " with a minimum face size of " << kMinFaceSize << "." << endl;
+    return -1;
+  }
+
+  seeta::fd::FuStDetector detector;
+  if (!detector.LoadModel(argv[1])) {
+    cout << "Failed to load the model: " << argv[1] << endl;
+    return -1;
+  }
+
+  // Structure of the model, and the stage of each classifier
+  seeta::fd::SURFFeatureMap surf_feat_map;
+  vector<StagePos> stage_pos;
+  vector<StageCost> stage_cost;
+  const vector<int32_t> & hierarchy_size = detector.hierarchy_size();
+  const vector<int32_t> & num_stage = detector.num_stage();
+  const vector<vector<int32_t> > & wnd_src_id = detector.wnd_src_id();
+
+  printf("Model: %s\n", argv[1]);
+  printf("Hierarchies: %d, classifiers: %zu, stages: %d\n",
+    detector.num_hierarchy(), num_stage.size(), detector.num_model());
+  int32_t cls_idx = 0;
+  for (int32_t i = 0; i < detector.num_hierarchy(); i++) {
+    printf("Hierarchy %d: %d classifiers\n", i, hierarchy_size[i]);
+    for (int32_t j = 0; j < hierarchy_size[i]; j++, cls_idx++) {
+      printf("  Classifier %d: %d stages, windows from", j, num_stage[cls_idx]);
+      if (wnd_src_id[cls_idx].empty())
+        printf(" the image pyramid");
+      for (size_t k = 0; k < wnd_src_id[cls_idx].size(); k++)
+        printf(" %d", wnd_src_id[cls_idx][k]);
+      printf("\n");
+
+      for (int32_t k = 0; k < num_stage[cls_idx]; k++) {
+        int32_t model_idx = static_cast<int32_t>(stage_pos.size());
+        seeta::fd::Classifier* model = detector.model(model_idx).get();
+        StagePos pos = { i, j, k };
+        stage_pos.push_back(pos);
+        stage_cost.push_back(EstimateCost(model, surf_feat_map));
+        printf("    Stage %d: ", k);
+        PrintStage(model, surf_feat_map);
+      }
+    }
+  }
+
+  printf("\nEstimated cost per window (max, early rejection not counted):\n");
+  printf("  %-10s %12s %12s\n", "stage", "ops", "model bytes");
+  int64_t total_bytes = 0;
+  for (size_t n = 0; n < stage_pos.size(); n++) {
+    printf("  %d.%d.%-6d %12lld %12lld\n", stage_pos[n].hierarchy,
+      stage_pos[n].classifier, stage_pos[n].stage,
+      static_cast<long long>(stage_cost[n].flops),
+      static_cast<long long>(stage_cost[n].bytes));
+    total_bytes += stage_cost[n].bytes;
+  }
+  printf("  %-10s %12s %12lld\n", "total", "", static_cast<long long>(total_bytes));
+
+  if (argc < 3)
+    return 0;
+
+  // Profile on the images, with the same image pyramid as FaceDetection
+  seeta::fd::FuStDetector::Profile profile;
+  profile.num_detection = 0;
+  profile.scan_time_ms = 0.0;
+  detector.SetWindowSize(kWndSize);
+  detector.SetSlideWindowStep(kWndStep, kWndStep);
+  detector.SetProfile(&profile);
+
+  seeta::fd::ImagePyramid img_pyramid;
+  img_pyramid.SetScaleStep(kScaleStep);
+  img_pyramid.SetMaxScale(static_cast<float>(kWndSize) / kMinFaceSize);
+  vector<uint8_t> data;
+  vector<seeta::FaceInfo> faces;
+  int64_t num_scan_wnd = 0;
+  int64_t num_face = 0;
+  double total_time_ms = 0.0;
+  for (int32_t n = 2; n < argc; n++) {
+    int32_t width = 0;
+    int32_t height = 0;
+    if (!ReadPGM(argv[n], &data, &width, &height)) {
+      cout << "Skipped, not a binary PGM image: " << argv[n] << endl;
+      continue;
+    }
+
+    img_pyramid.SetImage1x(data.data(), width, height);
+    img_pyramid.SetMinScale(static_cast<float>(kWndSize) /
+      std::min(width, height));
+    std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    detector.Detect(&img_pyramid, &faces);
+    total_time_ms += std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+    num_face += faces.size();
+
+    // Sizes of the levels follow from their scales, accumulated the same way
+    // as by the image pyramid, without resizing the image again
+    for (float scale = img_pyramid.max_scale();
+        scale >= img_pyramid.min_scale(); scale *= img_pyramid.scale_step()) {
+      int32_t level_width = static_cast<int32_t>(width * scale);
+      int32_t level_height = static_cast<int32_t>(height * scale);
+      if (level_width < kWndSize || level_height < kWndSize)
+        continue;
+      num_scan_wnd += static_cast<int64_t>(
+        (level_width - kWndSize) / kWndStep + 1) *
+        ((level_height - kWndSize) / kWndStep + 1);
+    }
+  }
+  detector.SetProfile(nullptr);
+  if (profile.num_detection == 0)
+    return 0;
+
+  printf("\nProfile on %d images: %lld windows scanned, %lld faces before "
+    "the score threshold, %.2f ms in total\n", profile.num_detection,
+    static_cast<long long>(num_scan_wnd), static_cast<long long>(num_face),
+    total_time_ms);
+  printf("  %-10s %12s %12s %8s %10s %10s\n", "stage", "windows in",
+    "windows out", "pass", "time ms", "us/window");
+  printf("  %-10s %12lld %12s %8s %10.2f %10.4f\n", "scan",
+    static_cast<long long>(num_scan_wnd), "", "", profile.scan_time_ms,
+    (num_scan_wnd > 0 ? 1e3 * profile.scan_time_ms / num_scan_wnd : 0.0));
+  for (size_t n = 0; n < stage_pos.size(); n++) {
+    const seeta::fd::FuStDetector::StageStat & stat = profile.stages[n];
+    // Views of the first hierarchy take all windows scanned
+    int64_t num_input = (stage_pos[n].hierarchy == 0 ? num_scan_wnd :
+      stat.num_input);
+    printf("  %d.%d.%-6d %12lld %12lld %7.3f%%", stage_pos[n].hierarchy,
+      stage_pos[n].classifier, stage_pos[n].stage,
+      static_cast<long long>(num_input),
+      static_cast<long long>(stat.num_output),
+      (num_input > 0 ? 100.0 * stat.num_output / num_input : 0.0));
+    if (stage_pos[n].hierarchy == 0) {
+      printf(" %10s %10s\n", "(scan)", "");
+    } else {
+      printf(" %10.2f %10.4f\n", stat.time_ms,
+        (stat.num_input > 0 ? 1e3 * stat.time_ms / stat.num_input : 0.0));
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+
+#include "util/cell_mask.h"
+
+#include <cstring>
+
+namespace seeta {
+namespace fd {
+
+void CellMask::Reset(int32_t width, int32_t height, bool active) {
+  width_ = width;
+  height_ = height;
+  num_cell_x_ = (width_ + kCellSize - 1) / kCellSize;
+  num_cell_y_ = (height_ + kCellSize - 1) / kCellSize;
+
+  cell_active_.assign(num_cell_x_ * num_cell_y_, (active ? 1 : 0));
+  num_active_cell_ = (active ? num_cell_x_ * num_cell_y_ : 0);
+}
+
+void CellMask::SetActive(const seeta::Rect & rect) {
+  int32_t x1 = std::max(rect.x, 0) / kCellSize;
+  int32_t y1 = std::max(rect.y, 0) / kCellSize;
+  int32_t x2 = std::min((rect.x + rect.width - 1) / kCellSize + 1,
+    num_cell_x_);
+  int32_t y2 = std::min((rect.y + rect.height - 1) / kCellSize + 1,
+    num_cell_y_);
+
+  for (int32_t y = y1; y < y2; y++) {
+    uint8_t* cell_active = cell_active_.data() + y * num_cell_x_;
+    for (int32_t x = x1; x < x2; x++) {
+      num_active_cell_ += (1 - cell_active[x]);
+      cell_active[x] = 1;
+    }
+  }
+}
+
+void CellMask::SetChanged(const uint8_t* prev, const uint8_t* cur) {
+  for (int32_t r = 0; r < height_; r++) {
+    uint8_t* cell_active = cell_active_.data() + (r / kCellSize) * num_cell_x_;
+    const uint8_t* src1 = prev + r * width_;
+    const uint8_t* src2 = cur + r * width_;
+    for (int32_t x = 0; x < num_cell_x_; x++) {
+      if (cell_active[x] != 0)
+        continue;
+      int32_t c = x * kCellSize;
+      int32_t len = std::min(width_ - c, static_cast<int32_t>(kCellSize));
+      if (std::memcmp(src1 + c, src2 + c, len) != 0) {
+        cell_active[x] = 1;
+        num_active_cell_++;
+      }
+    }
+  }
+}
+
+void CellMask::BuildIndex() {
+  int32_t stride = num_cell_x_ + 1;
+  cell_sum_.assign(stride * (num_cell_y_ + 1), 0);
+  for (int32_t y = 0; y < num_cell_y_; y++) {
+    const uint8_t* cell_active = cell_active_.data() + y * num_cell_x_;
+    const int32_t* above = cell_sum_.data() + y * stride;
+    int32_t* dest = cell_sum_.data() + (y + 1) * stride;
+    for (int32_t x = 0, s = 0; x < num_cell_x_; x++) {
+      s += cell_active[x];
+      dest[x + 1] = above[x + 1] + s;
+    }
+  }
+}
+
+}  // namespace fd
+}  // namespace seeta
@@ -0,0 +1,137 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include "util/image_atlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "util/image_pyramid.h"
+
+namespace seeta {
+namespace fd {
+
+void ImageAtlas::SetImages(const std::vector<seeta::ImageData> & images,
+    const std::vector<float> & min_scales) {
+  images_.assign(images.begin(), images.end());
+  min_scales_.assign(min_scales.begin(), min_scales.end());
+  min_scale_ = max_scale_;
+  for (size_t i = 0; i < min_scales_.size(); i++)
+    min_scale_ = std::min(min_scale_, min_scales_[i]);
+  scale_factor_ = max_scale_;
+}
+
+const seeta::ImageData* ImageAtlas::GetNextLevel(float* scale_factor) {
+  // Scales are accumulated as in ImagePyramid to get the same scaled images
+  tiles_.clear();
+  while (tiles_.empty() && scale_factor_ >= min_scale_ && !images_.empty()) {
+    for (size_t i = 0; i < images_.size(); i++) {
+      if (scale_factor_ < min_scales_[i])
+        continue;
+      Tile tile;
+      tile.image_idx = static_cast<int32_t>(i);
+      tile.rect.x = tile.rect.y = 0;
+      tile.rect.width = static_cast<int32_t>(images_[i].width * scale_factor_);
+      tile.rect.height =
+        static_cast<int32_t>(images_[i].height * scale_factor_);
+      if (tile.rect.width >= min_tile_size_ &&
+          tile.rect.height >= min_tile_size_)
+        tiles_.push_back(tile);
+    }
+    if (scale_factor != nullptr)
+      *scale_factor = scale_factor_;
+    scale_factor_ *= scale_step_;
+  }
+  if (tiles_.empty())
+    return nullptr;
+
+  PackTiles();
+  buf_.assign(atlas_.width * atlas_.height, 0);
+  atlas_.data = buf_.data();
+  atlas_.num_channels = 1;
+
+  int32_t num_tile = static_cast<int32_t>(tiles_.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(SEETA_NUM_THREADS)
+  for (int32_t t = 0; t < num_tile; t++) {
+    const Tile & tile = tiles_[t];
+    seeta::ImageData dest(tile.rect.width, tile.rect.height);
+    dest.data = buf_.data() + tile.rect.y * atlas_.width + tile.rect.x;
+    seeta::fd::ResizeImage(images_[tile.image_idx], &dest, atlas_.width);
+  }
+  return &atlas_;
+}
+
+void ImageAtlas::PackTiles() {
+  int32_t num_tile = static_cast<int32_t>(tiles_.size());
+  tile_order_.resize(num_tile);
+  int64_t area = 0;
+  int32_t max_width = 0;
+  for (int32_t t = 0; t < num_tile; t++) {
+    tile_order_[t] = t;
+    int32_t width = (tiles_[t].rect.width + align_x_ - 1) / align_x_ * align_x_;
+    int32_t height =
+      (tiles_[t].rect.height + align_y_ - 1) / align_y_ * align_y_;
+    area += static_cast<int64_t>(width) * height;
+    max_width = std::max(max_width, width);
+  }
+  std::stable_sort(tile_order_.begin(), tile_order_.end(),
+    [this](int32_t a, int32_t b) {
+      return tiles_[a].rect.height > tiles_[b].rect.height;
+    });
+
+  // Roughly square, so that neither side of the feature map gets too long
+  int32_t atlas_width = std::max(max_width,
+    static_cast<int32_t>(std::ceil(std::sqrt(static_cast<double>(area)))));
+  atlas_width = (atlas_width + align_x_ - 1) / align_x_ * align_x_;
+
+  int32_t x = 0;
+  int32_t y = 0;
+  int32_t shelf_height = 0;
+  for (int32_t n = 0; n < num_tile; n++) {
+    seeta::Rect & rect = tiles_[tile_order_[n]].rect;
+    if (x + rect.width > atlas_width) {
+      x = 0;
+      y += shelf_height;
+      shelf_height = 0;
+    }
+    rect.x = x;
+    rect.y = y;
+    x += (rect.width + align_x_ - 1) / align_x_ * align_x_;
+    shelf_height = std::max(shelf_height,
+      (rect.height + align_y_ - 1) / align_y_ * align_y_);
+  }
+  atlas_.width = atlas_width;
+  atlas_.height = y + shelf_height;
+}
+
+}  // namespace fd
+}  // namespace seeta
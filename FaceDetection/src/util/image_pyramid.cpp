@@ -35,29 +35,200 @@ namespace seeta {
 namespace fd {
 
 const seeta::ImageData* ImagePyramid::GetNextScaleImage(float* scale_factor) {
-  if (scale_factor_ >= min_scale_) {
+  UpdateScalePlan();
+  while (next_level_ < static_cast<int32_t>(scale_plan_.levels.size()) &&
+      !is_level_enabled(next_level_))
+    next_level_++;
+  if (next_level_ < static_cast<int32_t>(scale_plan_.levels.size())) {
     if (scale_factor != nullptr)
-      *scale_factor = scale_factor_;
-
-    width_scaled_ = static_cast<int32_t>(width1x_ * scale_factor_);
-    height_scaled_ = static_cast<int32_t>(height1x_ * scale_factor_);
-
-    seeta::ImageData src_img(width1x_, height1x_);
-    seeta::ImageData dest_img(width_scaled_, height_scaled_);
-    src_img.data = buf_img_;
-    dest_img.data = buf_img_scaled_;
-    seeta::fd::ResizeImage(src_img, &dest_img);
-    scale_factor_ *= scale_step_;
-
-    img_scaled_.data = buf_img_scaled_;
-    img_scaled_.width = width_scaled_;
-    img_scaled_.height = height_scaled_;
-    return &img_scaled_;
+      *scale_factor = scale_plan_.levels[next_level_].scale;
+    return ScaleImage(next_level_++);
   } else {
     return nullptr;
   }
 }
 
+int32_t ImagePyramid::num_level() const {
+  int32_t num_level = 0;
+  for (float scale = max_scale_; scale >= min_scale_; scale *= scale_step_)
+    num_level++;
+  return num_level;
+}
+
+const seeta::ImageData* ImagePyramid::GetScaleImage(int32_t level,
+    float* scale_factor) {
+  UpdateScalePlan();
+  if (level < 0 || level >= static_cast<int32_t>(scale_plan_.levels.size()))
+    return nullptr;
+
+  if (scale_factor != nullptr)
+    *scale_factor = scale_plan_.levels[level].scale;
+  return ScaleImage(level);
+}
+
+void ImagePyramid::BuildLevels() {
+  LayOutLevels();
+  for (int32_t i = 0; i < static_cast<int32_t>(levels_.size()); i++) {
+    if (is_level_enabled(i) && level_built_[i] == 0) {
+      ScaleImage(i, levels_[i].data);
+      level_built_[i] = 1;
+    }
+  }
+}
+
+void ImagePyramid::BuildLevel(int32_t level) {
+  LayOutLevels();
+  if (level < 0 || level >= static_cast<int32_t>(levels_.size()) ||
+      level_built_[level] != 0)
+    return;
+  ScaleImage(level, levels_[level].data);
+  level_built_[level] = 1;
+}
+
+void ImagePyramid::LayOutLevels() {
+  if (is_levels_built_)
+    return;
+
+  UpdateScalePlan();
+  int32_t num = static_cast<int32_t>(scale_plan_.levels.size());
+  levels_.resize(num);
+  level_scales_.resize(num);
+  level_built_.assign(num, 0);
+  size_t arena_size = kArenaAlign;
+  for (int32_t i = 0; i < num; i++) {
+    const LevelPlan & plan = scale_plan_.levels[i];
+    levels_[i].width = plan.width;
+    levels_[i].height = plan.height;
+    levels_[i].num_channels = 1;
+    level_scales_[i] = plan.scale;
+    size_t len = static_cast<size_t>(plan.width) * plan.height;
+    arena_size += (len + kArenaAlign - 1) / kArenaAlign * kArenaAlign;
+  }
+
+  if (arena_size > arena_size_) {
+    delete[] arena_;
+    arena_size_ = arena_size;
+    arena_ = new uint8_t[arena_size_];
+  }
+
+  uintptr_t addr = reinterpret_cast<uintptr_t>(arena_);
+  uint8_t* dest = arena_ + (kArenaAlign - addr % kArenaAlign) % kArenaAlign;
+  for (int32_t i = 0; i < num; i++) {
+    levels_[i].data = dest;
+    size_t len = static_cast<size_t>(levels_[i].width) * levels_[i].height;
+    dest += (len + kArenaAlign - 1) / kArenaAlign * kArenaAlign;
+  }
+  is_levels_built_ = true;
+}
+
+const seeta::ImageData* ImagePyramid::GetLevel(int32_t level,
+    float* scale_factor) const {
+  if (!is_levels_built_ || level < 0 ||
+      level >= static_cast<int32_t>(levels_.size()))
+    return nullptr;
+
+  if (scale_factor != nullptr)
+    *scale_factor = level_scales_[level];
+  return &(levels_[level]);
+}
+
+void ImagePyramid::UpdateScalePlan() {
+  if (scale_plan_.width == width1x_ && scale_plan_.height == height1x_ &&
+      scale_plan_.max_scale == max_scale_ &&
+      scale_plan_.min_scale == min_scale_ &&
+      scale_plan_.scale_step == scale_step_)
+    return;
+
+  scale_plan_.width = width1x_;
+  scale_plan_.height = height1x_;
+  scale_plan_.max_scale = max_scale_;
+  scale_plan_.min_scale = min_scale_;
+  scale_plan_.scale_step = scale_step_;
+  scale_plan_.levels.clear();
+  if (width1x_ == 0 || height1x_ == 0)
+    return;
+
+  // Scales are accumulated as in num_level(), and the source coordinates and
+  // weights are computed with the same double arithmetic as ResizeImage(),
+  // so that scaled images are bit-exact.
+  for (float scale = max_scale_; scale >= min_scale_; scale *= scale_step_) {
+    LevelPlan plan;
+    plan.width = static_cast<int32_t>(width1x_ * scale);
+    plan.height = static_cast<int32_t>(height1x_ * scale);
+    plan.scale = scale;
+
+    if (plan.width != width1x_ || plan.height != height1x_) {
+      double lf_x_scl = static_cast<double>(width1x_) / plan.width;
+      double lf_y_scl = static_cast<double>(height1x_) / plan.height;
+      plan.src_x.resize(plan.width);
+      plan.weight_x.resize(plan.width);
+      for (int32_t x = 0; x < plan.width; x++) {
+        double lf_x_s = lf_x_scl * x;
+        int32_t n_x_s = static_cast<int>(lf_x_s);
+        n_x_s = (n_x_s <= (width1x_ - 2) ? n_x_s : (width1x_ - 2));
+        plan.src_x[x] = n_x_s;
+        plan.weight_x[x] = lf_x_s - n_x_s;
+      }
+      plan.src_y.resize(plan.height);
+      plan.weight_y.resize(plan.height);
+      for (int32_t y = 0; y < plan.height; y++) {
+        double lf_y_s = lf_y_scl * y;
+        int32_t n_y_s = static_cast<int>(lf_y_s);
+        n_y_s = (n_y_s <= (height1x_ - 2) ? n_y_s : (height1x_ - 2));
+        plan.src_y[y] = n_y_s;
+        plan.weight_y[y] = lf_y_s - n_y_s;
+      }
+    }
+    scale_plan_.levels.push_back(plan);
+  }
+}
+
+void ImagePyramid::ScaleImage(int32_t level, uint8_t* dest) const {
+  const LevelPlan & plan = scale_plan_.levels[level];
+  if (plan.src_x.empty()) {
+    std::memcpy(dest, buf_img_, width1x_ * height1x_ * sizeof(uint8_t));
+    return;
+  }
+
+  const uint8_t* src_data = buf_img_;
+  int32_t src_width = width1x_;
+  int32_t dest_width = plan.width;
+
+#pragma omp parallel num_threads(SEETA_NUM_THREADS)
+  {
+#pragma omp for nowait
+    for (int32_t y = 0; y < plan.height; y++) {
+      double lf_weight_y = plan.weight_y[y];
+      const uint8_t* src_row = src_data + plan.src_y[y] * src_width;
+      const uint8_t* src_row_next = src_row + src_width;
+      uint8_t* dest_row = dest + y * dest_width;
+      for (int32_t x = 0; x < dest_width; x++) {
+        int32_t n_x_s = plan.src_x[x];
+        double lf_weight_x = plan.weight_x[x];
+
+        double dest_val = (1 - lf_weight_y) * ((1 - lf_weight_x) *
+          src_row[n_x_s] + lf_weight_x * src_row[n_x_s + 1]) +
+          lf_weight_y * ((1 - lf_weight_x) * src_row_next[n_x_s] +
+          lf_weight_x * src_row_next[n_x_s + 1]);
+
+        dest_row[x] = static_cast<uint8_t>(dest_val);
+      }
+    }
+  }
+}
+
+const seeta::ImageData* ImagePyramid::ScaleImage(int32_t level) {
+  const LevelPlan & plan = scale_plan_.levels[level];
+  width_scaled_ = plan.width;
+  height_scaled_ = plan.height;
+  ScaleImage(level, buf_img_scaled_);
+
+  img_scaled_.data = buf_img_scaled_;
+  img_scaled_.width = width_scaled_;
+  img_scaled_.height = height_scaled_;
+  return &img_scaled_;
+}
+
 void ImagePyramid::SetImage1x(const uint8_t* img_data, int32_t width,
     int32_t height) {
   if (width > buf_img_width_ || height > buf_img_height_) {
@@ -71,7 +242,8 @@ void ImagePyramid::SetImage1x(const uint8_t* img_data, int32_t width,
   width1x_ = width;
   height1x_ = height;
   std::memcpy(buf_img_, img_data, width * height * sizeof(uint8_t));
-  scale_factor_ = max_scale_;
+  next_level_ = 0;
+  is_levels_built_ = false;
   UpdateBufScaled();
 }
 
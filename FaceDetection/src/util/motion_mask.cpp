@@ -0,0 +1,101 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+
+#include "util/motion_mask.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef USE_SSE
+#include <immintrin.h>
+#endif
+
+namespace seeta {
+namespace fd {
+
+bool MotionMask::Update(const seeta::ImageData & img) {
+  if (img.width != width_ || img.height != height_ || background_.empty()) {
+    Reset(img.width, img.height, true);
+    background_.resize(width_ * height_);
+    std::memcpy(background_.data(), img.data,
+      width_ * height_ * sizeof(uint8_t));
+    cell_count_.assign(num_cell_x_ * num_cell_y_, 0);
+    return false;
+  }
+
+  cell_count_.assign(num_cell_x_ * num_cell_y_, 0);
+  for (int32_t r = 0; r < height_; r++) {
+    UpdateRow(img.data + r * width_, background_.data() + r * width_,
+      cell_count_.data() + (r / kCellSize) * num_cell_x_);
+  }
+
+  num_active_cell_ = 0;
+  for (size_t i = 0; i < cell_count_.size(); i++) {
+    cell_active_[i] = (cell_count_[i] >= kMinNumPixel ? 1 : 0);
+    num_active_cell_ += cell_active_[i];
+  }
+  return true;
+}
+
+void MotionMask::UpdateRow(const uint8_t* src, uint8_t* bg,
+    int32_t* cell_count) {
+  // The background moves a quarter of the way towards the frame, i.e.
+  // bg = avg(bg, avg(bg, src)) with the rounding of _mm_avg_epu8().
+  int32_t c = 0;
+#ifdef USE_SSE
+  // One 16-byte vector covers exactly one cell
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8(1);
+  const __m128i thresh = _mm_set1_epi8(static_cast<char>(diff_thresh_));
+  for (; c + kCellSize <= width_; c += kCellSize) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + c));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bg + c));
+    __m128i diff = _mm_or_si128(_mm_subs_epu8(x, b), _mm_subs_epu8(b, x));
+    __m128i is_moving = _mm_min_epu8(_mm_subs_epu8(diff, thresh), one);
+    __m128i count = _mm_sad_epu8(is_moving, zero);
+    cell_count[c / kCellSize] += _mm_cvtsi128_si32(count) +
+      _mm_extract_epi16(count, 4);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(bg + c),
+      _mm_avg_epu8(b, _mm_avg_epu8(b, x)));
+  }
+#endif
+  for (; c < width_; c++) {
+    int32_t x = src[c];
+    int32_t b = bg[c];
+    if (std::abs(x - b) > diff_thresh_)
+      cell_count[c / kCellSize]++;
+    bg[c] = static_cast<uint8_t>((b + ((b + x + 1) >> 1) + 1) >> 1);
+  }
+}
+
+}  // namespace fd
+}  // namespace seeta
@@ -43,13 +43,17 @@ bool CompareBBox(const seeta::FaceInfo & a, const seeta::FaceInfo & b) {
 }
 
 void NonMaximumSuppression(std::vector<seeta::FaceInfo>* bboxes,
-  std::vector<seeta::FaceInfo>* bboxes_nms, float iou_thresh) {
+  std::vector<seeta::FaceInfo>* bboxes_nms, float iou_thresh,
+  std::vector<int32_t>* mask_buf) {
   bboxes_nms->clear();
   std::sort(bboxes->begin(), bboxes->end(), seeta::fd::CompareBBox);
 
   int32_t select_idx = 0;
   int32_t num_bbox = static_cast<int32_t>(bboxes->size());
-  std::vector<int32_t> mask_merged(num_bbox, 0);
+  std::vector<int32_t> mask_merged_local;
+  std::vector<int32_t> & mask_merged =
+    (mask_buf != nullptr ? *mask_buf : mask_merged_local);
+  mask_merged.assign(num_bbox, 0);
   bool all_merged = false;
 
   while (!all_merged) {
@@ -94,5 +98,41 @@ void NonMaximumSuppression(std::vector<seeta::FaceInfo>* bboxes,
   }
 }
 
+namespace {
+
+float ComputeIoU(const seeta::Rect & a, const seeta::Rect & b) {
+  int32_t x1 = std::max(a.x, b.x);
+  int32_t y1 = std::max(a.y, b.y);
+  int32_t x2 = std::min(a.x + a.width, b.x + b.width);
+  int32_t y2 = std::min(a.y + a.height, b.y + b.height);
+  if (x2 <= x1 || y2 <= y1)
+    return 0.0f;
+
+  float area_intersect = static_cast<float>((x2 - x1) * (y2 - y1));
+  float area_union = static_cast<float>(a.width * a.height +
+    b.width * b.height) - area_intersect;
+  return area_intersect / area_union;
+}
+
+}  // namespace
+
+void MergeOverlappedFaces(std::vector<seeta::FaceInfo>* faces,
+    float iou_thresh, std::vector<seeta::FaceInfo>* buf) {
+  std::sort(faces->begin(), faces->end(), seeta::fd::CompareBBox);
+
+  std::vector<seeta::FaceInfo> merged_local;
+  std::vector<seeta::FaceInfo> & merged =
+    (buf != nullptr ? *buf : merged_local);
+  merged.clear();
+  for (size_t i = 0; i < faces->size(); i++) {
+    bool is_merged = false;
+    for (size_t j = 0; !is_merged && j < merged.size(); j++)
+      is_merged = (ComputeIoU((*faces)[i].bbox, merged[j].bbox) > iou_thresh);
+    if (!is_merged)
+      merged.push_back((*faces)[i]);
+  }
+  faces->swap(merged);
+}
+
 }  // namespace fd
 }  // namespace seeta